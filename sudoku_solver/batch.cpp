@@ -0,0 +1,363 @@
+#include "batch.h"
+#include "corpus.h"
+#include "puzzle_io.h"
+#include "parallel_search.h"
+#include "solve_cache.h"
+#include "thread_pool.h"
+#include "validate.h"
+#include <condition_variable>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+using namespace std;
+
+//Run of consecutive input puzzles handed to one worker. Chunks are recycled,
+//so once the stream settles their buffers stop allocating.
+struct BatchChunk {
+    uint64_t sequence = 0;
+    uint64_t firstPuzzle = 0;   //Input number of the chunk's first puzzle
+    size_t count = 0;           //Puzzles in the chunk
+    const CorpusReader* corpus = nullptr;   //Set when the puzzles are corpus records
+    string text;                //Puzzle fields back to back
+    vector<size_t> ends;        //End offset of every puzzle in text
+    string results;
+    vector<uint8_t> records;    //Binary results with options.recordOut
+    BatchStats stats;
+
+    vector<uint8_t> boards;     //Parsed 9x9 boards, 81 cells each
+    vector<uint8_t> valid;      //validateBoards9() result per board
+    vector<int> boardOf;        //Board of every puzzle, -1 if it is not a parsed 9x9
+};
+
+PuzzleStatus solvePuzzleLine(const char* line, size_t length, const BatchOptions& options,
+                             Grid& grid, string& out, WorkStealingPool* searchPool, SolveStats* stats) {
+    if (!parsePuzzle(line, length, grid) || !isValidSudoku(grid)) {
+        out += "invalid\n";
+        return PUZZLE_INVALID;
+    }
+    return solvePuzzle(grid, options, out, searchPool, stats);
+}
+
+PuzzleStatus solvePuzzle(Grid& grid, const BatchOptions& options, string& out,
+                         WorkStealingPool* searchPool, SolveStats* stats) {
+    if (options.countLimit > 0) {
+        uint64_t count = countSolutions(grid, options.countLimit, nullptr, stats);
+        if (count == 0) {
+            out += "unsolvable\n";
+            return PUZZLE_UNSOLVABLE;
+        }
+        formatPuzzle(grid, out);
+        out += ' ';
+        out += to_string(count);
+        out += '\n';
+        return count == 1 ? PUZZLE_SOLVED : PUZZLE_MULTIPLE;
+    }
+
+    bool solved;
+    if (searchPool != nullptr) {
+        ParallelSearchStats search;
+        solved = solveSudokuParallel(grid, *searchPool, &search);
+        if (stats != nullptr) {
+            stats->solves++;
+            stats->nodes += search.nodes;
+        }
+    } else if (options.cache != nullptr) {
+        solved = options.cache->solve(grid, options.mode, nullptr, stats, options.trace);
+    } else {
+        solved = solveSudokuWith(grid, options.mode, nullptr, stats, options.trace);
+    }
+    if (!solved) {
+        out += "unsolvable\n";
+        return PUZZLE_UNSOLVABLE;
+    }
+    formatPuzzle(grid, out);
+    out += '\n';
+    return PUZZLE_SOLVED;
+}
+
+static void countStatus(BatchStats& stats, PuzzleStatus status) {
+    stats.puzzles++;
+    if (status == PUZZLE_SOLVED) {
+        stats.solved++;
+    } else if (status == PUZZLE_MULTIPLE) {
+        stats.solved++;
+        stats.multiple++;
+    } else if (status == PUZZLE_INVALID) {
+        stats.invalid++;
+    } else {
+        stats.unsolvable++;
+    }
+}
+
+static void addStats(BatchStats& total, const BatchStats& part) {
+    total.puzzles += part.puzzles;
+    total.solved += part.solved;
+    total.invalid += part.invalid;
+    total.unsolvable += part.unsolvable;
+    total.multiple += part.multiple;
+    total.solve.add(part.solve);
+}
+
+//Corpus records are not parsed, so nothing else keeps their cells in 0..N;
+//isValidSudoku() would take a cell above N for a given that never clashes
+static bool cellsInRange(const uint8_t* cells, int N) {
+    for (int i = 0; i < N * N; i++)
+        if (cells[i] > N)
+            return false;
+    return true;
+}
+
+//Reads up to chunkSize puzzle lines into the chunk; false once the input is exhausted
+static bool fillChunk(LineReader& reader, BatchChunk& chunk, size_t chunkSize) {
+    chunk.text.clear();
+    chunk.ends.clear();
+    const char* line;
+    size_t length;
+    while (chunk.ends.size() < chunkSize && reader.next(line, length)) {
+        if (!puzzleField(line, length))
+            continue;
+        chunk.text.append(line, length);
+        chunk.ends.push_back(chunk.text.size());
+    }
+    chunk.count = chunk.ends.size();
+    return chunk.count == chunkSize;
+}
+
+//Solves every puzzle of a chunk into its results, or into binary records
+//with options.recordOut. The 9x9 boards are staged first (parsed from text,
+//unpacked from nibbles, or read in place from a byte-packed corpus) and
+//validated in one validateBoards9() call.
+static void solveChunk(BatchChunk& work, Grid& grid, const BatchOptions& options, WorkStealingPool* searchPool) {
+    const int CELLS = 81;
+    const CorpusReader* corpus = work.corpus;
+    const CorpusFormat* format = options.recordOut != nullptr ? &options.recordOut->format : nullptr;
+    work.results.clear();
+    work.records.clear();
+    work.stats = BatchStats();
+    work.boards.resize(work.count * CELLS);
+    work.boardOf.assign(work.count, -1);
+    SolveStats* solveStats = options.collectStats ? &work.stats.solve : nullptr;
+    bool recordStats = format != nullptr && (format->flags & CORPUS_STATS);
+
+    const uint8_t* boards = work.boards.data();
+    size_t count = 0;
+    size_t start = 0;
+    if (corpus == nullptr) {
+        for (size_t k = 0; k < work.count; k++) {
+            if (work.ends[k] - start == (size_t)CELLS
+                && parseCells(work.text.data() + start, 9, work.boards.data() + count * CELLS))
+                work.boardOf[k] = (int)count++;
+            start = work.ends[k];
+        }
+    } else if (corpus->format().geometry == BoardGeometry::standard(9)) {
+        //Records holding nothing but byte-packed cells already are a board array
+        if (corpus->puzzleCells(work.firstPuzzle) != nullptr && corpus->format().recordSize() == (size_t)CELLS) {
+            boards = corpus->puzzleCells(work.firstPuzzle);
+        } else {
+            for (size_t k = 0; k < work.count; k++)
+                corpus->format().unpack(corpus->record(work.firstPuzzle + k), work.boards.data() + k * CELLS);
+        }
+        for (size_t k = 0; k < work.count; k++)
+            work.boardOf[k] = (int)k;
+        count = work.count;
+    }
+    work.valid.resize(count);
+    validateBoards9(boards, count, work.valid.data());
+    for (size_t k = 0; corpus != nullptr && k < count; k++)
+        if (!cellsInRange(boards + k * CELLS, 9))
+            work.valid[k] = 0;
+
+    start = 0;
+    for (size_t k = 0; k < work.count; k++) {
+        if (options.trace != nullptr)
+            options.trace->puzzle = work.firstPuzzle + k;
+        int board = work.boardOf[k];
+        bool loaded = true;
+        bool valid;
+        if (board >= 0) {
+            if (grid.N != 9)
+                grid.resize(9);
+            memcpy(grid.data(), boards + board * CELLS, CELLS);
+            valid = work.valid[board] != 0;
+        } else {
+            if (corpus != nullptr)
+                corpus->puzzle(work.firstPuzzle + k, grid);
+            else
+                loaded = parsePuzzle(work.text.data() + start, work.ends[k] - start, grid);
+            if (loaded && grid.N == options.boxes.N)
+                grid.geometry = options.boxes;
+            valid = loaded && (corpus == nullptr || cellsInRange(grid.data(), grid.N)) && isValidSudoku(grid);
+        }
+        if (corpus == nullptr)
+            start = work.ends[k];
+
+        //A record has room for boards of the output shape only
+        uint8_t* record = nullptr;
+        if (format != nullptr) {
+            size_t at = work.records.size();
+            work.records.resize(at + format->recordSize());
+            record = &work.records[at];
+            if (loaded && grid.geometry == format->geometry)
+                format->pack(grid.data(), record);
+            else
+                valid = false;
+        }
+
+        PuzzleStatus status;
+        SolveStats puzzleStats;
+        if (!valid) {
+            work.results += "invalid\n";
+            status = PUZZLE_INVALID;
+        } else {
+            status = solvePuzzle(grid, options, work.results, searchPool,
+                                 recordStats ? &puzzleStats : solveStats);
+        }
+        countStatus(work.stats, status);
+
+        if (record != nullptr) {
+            if ((format->flags & CORPUS_SOLUTIONS) && (status == PUZZLE_SOLVED || status == PUZZLE_MULTIPLE))
+                format->pack(grid.data(), record + format->solutionOffset());
+            if (recordStats)
+                format->writeStats(record, status, puzzleStats.nodes);
+            work.results.clear();
+        }
+        if (recordStats && solveStats != nullptr)
+            solveStats->add(puzzleStats);
+    }
+}
+
+//Hands the chunk's output to the text stream or the record writer
+static void writeChunk(OutputBuffer& writer, const BatchChunk& chunk, const BatchOptions& options) {
+    if (options.recordOut != nullptr)
+        options.recordOut->appendRecords(chunk.records.data(), chunk.count);
+    else
+        writer.append(chunk.results);
+}
+
+//Runs the chunks produced by fill(chunk) (false once the input is exhausted)
+//on a work-stealing pool, writing them back in order
+template <class Fill>
+static BatchStats solveChunksParallel(Fill fill, FILE* out, const BatchOptions& options) {
+    WorkStealingPool pool(options.threads);
+
+    //A few chunks per worker keeps everyone busy while bounding memory
+    vector<BatchChunk> chunks(pool.size() * 4);
+    vector<int> freeChunks;
+    for (int i = (int)chunks.size() - 1; i >= 0; i--)
+        freeChunks.push_back(i);
+    vector<Grid> grids(pool.size());
+
+    mutex doneLock;
+    condition_variable doneSignal;
+    map<uint64_t, int> finished;    //Sequence number -> chunk index
+
+    BatchStats stats;
+    OutputBuffer writer(out);
+    uint64_t nextSequence = 0;
+    uint64_t nextWrite = 0;
+    int inFlight = 0;
+    bool inputDone = false;
+    vector<int> ready;
+
+    while (true) {
+        while (!inputDone && !freeChunks.empty()) {
+            int index = freeChunks.back();
+            BatchChunk& chunk = chunks[index];
+            if (!fill(chunk))
+                inputDone = true;
+            if (chunk.count == 0)
+                break;
+
+            freeChunks.pop_back();
+            chunk.sequence = nextSequence++;
+            inFlight++;
+            pool.submit([&, index](int worker) {
+                BatchChunk& work = chunks[index];
+                solveChunk(work, grids[worker], options, nullptr);
+                lock_guard<mutex> lock(doneLock);
+                finished[work.sequence] = index;
+                doneSignal.notify_one();
+            });
+        }
+        if (inFlight == 0)
+            break;
+
+        ready.clear();
+        {
+            unique_lock<mutex> lock(doneLock);
+            if (options.unordered) {
+                doneSignal.wait(lock, [&] { return !finished.empty(); });
+                for (map<uint64_t, int>::iterator it = finished.begin(); it != finished.end(); ++it)
+                    ready.push_back(it->second);
+                finished.clear();
+            } else {
+                doneSignal.wait(lock, [&] { return !finished.empty() && finished.begin()->first == nextWrite; });
+                while (!finished.empty() && finished.begin()->first == nextWrite) {
+                    ready.push_back(finished.begin()->second);
+                    finished.erase(finished.begin());
+                    nextWrite++;
+                }
+            }
+        }
+
+        for (size_t k = 0; k < ready.size(); k++) {
+            BatchChunk& chunk = chunks[ready[k]];
+            writeChunk(writer, chunk, options);
+            addStats(stats, chunk.stats);
+            freeChunks.push_back(ready[k]);
+            inFlight--;
+        }
+    }
+    writer.flush();
+    return stats;
+}
+
+template <class Fill>
+static BatchStats solveChunks(Fill fill, FILE* out, const BatchOptions& options) {
+    if (options.threads != 1 && !options.parallelSearch && options.trace == nullptr)
+        return solveChunksParallel(fill, out, options);
+
+    unique_ptr<WorkStealingPool> searchPool;
+    if (options.parallelSearch)
+        searchPool.reset(new WorkStealingPool(options.threads));
+
+    BatchStats stats;
+    OutputBuffer writer(out);
+    Grid grid;
+    BatchChunk chunk;
+    bool more = true;
+    while (more) {
+        more = fill(chunk);
+        solveChunk(chunk, grid, options, searchPool.get());
+        writeChunk(writer, chunk, options);
+        addStats(stats, chunk.stats);
+    }
+    writer.flush();
+    return stats;
+}
+
+BatchStats solveBatch(FILE* in, FILE* out, const BatchOptions& options) {
+    LineReader reader(in);
+    size_t chunkSize = options.chunkSize > 0 ? options.chunkSize : 1;
+    uint64_t nextPuzzle = 0;
+    return solveChunks([&](BatchChunk& chunk) {
+        bool more = fillChunk(reader, chunk, chunkSize);
+        chunk.firstPuzzle = nextPuzzle;
+        nextPuzzle += chunk.count;
+        return more;
+    }, out, options);
+}
+
+BatchStats solveBatch(const CorpusReader& in, FILE* out, const BatchOptions& options) {
+    size_t chunkSize = options.chunkSize > 0 ? options.chunkSize : 1;
+    uint64_t nextPuzzle = 0;
+    return solveChunks([&](BatchChunk& chunk) {
+        chunk.corpus = &in;
+        chunk.firstPuzzle = nextPuzzle;
+        chunk.count = (size_t)min<uint64_t>(chunkSize, in.count() - nextPuzzle);
+        nextPuzzle += chunk.count;
+        return nextPuzzle < in.count();
+    }, out, options);
+}
@@ -0,0 +1,74 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "sudoku.h"
+#include "geometry.h"
+#include "solve_stats.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class WorkStealingPool;
+class CorpusReader;
+struct CorpusWriter;
+class SolveCache;
+
+struct BatchOptions {
+    SolveMode mode = SOLVE_PROPAGATE;
+    int threads = 1;            //0 picks one per core
+    bool unordered = false;     //Write results as they finish instead of in input order
+    size_t chunkSize = 512;     //Puzzles per task
+    bool parallelSearch = false;    //One puzzle at a time, its search split over the threads
+    uint64_t countLimit = 0;    //Above 0, count solutions up to this many instead of solving
+    bool collectStats = false;  //Fill BatchStats::solve; timing every puzzle is not free
+    SolveTrace* trace = nullptr;    //Records every solve's guesses; runs on one thread, not with parallel search
+    CorpusWriter* recordOut = nullptr;  //Results as corpus records here instead of text lines
+    SolveCache* cache = nullptr;    //Solves go through this cache, not with parallel search or counting
+    BoardGeometry boxes;        //Box shape for boards of size boxes.N; the others get the standard one, or the corpus's
+};
+
+struct BatchStats {
+    uint64_t puzzles = 0;
+    uint64_t solved = 0;
+    uint64_t invalid = 0;       //Malformed line or isValidSudoku() rejected it
+    uint64_t unsolvable = 0;
+    uint64_t multiple = 0;      //Counted more than one solution (also in solved)
+    SolveStats solve;           //Engine counters over every solve, with options.collectStats
+};
+
+//Outcome of one puzzle line
+enum PuzzleStatus { PUZZLE_SOLVED, PUZZLE_MULTIPLE, PUZZLE_INVALID, PUZZLE_UNSOLVABLE };
+
+//Solves a parsed board that already passed isValidSudoku(), appending the
+//result line to out and adding the engine counters to stats when given
+PuzzleStatus solvePuzzle(Grid& grid, const BatchOptions& options, std::string& out,
+                         WorkStealingPool* searchPool = nullptr, SolveStats* stats = nullptr);
+
+//Validates and solves one puzzle line, appending the result line to out:
+//the solved board, "invalid" or "unsolvable", followed by a newline.
+//With a searchPool the propagation search is split over its workers.
+//With options.countLimit the board is the first solution followed by a space
+//and the number of solutions found, which stops at the limit.
+PuzzleStatus solvePuzzleLine(const char* line, size_t length, const BatchOptions& options,
+                             Grid& grid, std::string& out,
+                             WorkStealingPool* searchPool = nullptr, SolveStats* stats = nullptr);
+
+//Reads one puzzle per line (blank lines and '#' comments are skipped, and
+//anything after the first space or tab is ignored) and writes one result
+//line per puzzle. With more than one thread, chunks of puzzles are spread
+//over a work-stealing pool and reassembled in input order unless the
+//options ask for unordered output. The 9x9 boards of a chunk are validated
+//together with validateBoards9(). Boards of size options.boxes.N take its box
+//shape. With options.recordOut the results go to
+//that writer as records instead (out is unused), and boards of another
+//shape than its format count as invalid.
+BatchStats solveBatch(FILE* in, FILE* out, const BatchOptions& options);
+
+//Same over the records of a mapped binary corpus (see corpus.h), which
+//skips parsing. Boards take the box shape stored in the corpus unless
+//options.boxes covers their size. Byte-packed 9x9 corpora are validated in
+//place.
+BatchStats solveBatch(const CorpusReader& in, FILE* out, const BatchOptions& options);
+
+#endif // BATCH_H
@@ -0,0 +1,281 @@
+//Benchmark: runs the engines over the bundled corpora in bench/ and reports
+//puzzles per second, p50/p99/max latency and search nodes per puzzle.
+//--json writes the same numbers in a machine-readable form, so runs on
+//different commits can be compared.
+#include "sudoku.h"
+#include "puzzle_io.h"
+#include "solve_cache.h"
+#include "validate.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#ifndef SUDOKU_BENCH_DIR
+#define SUDOKU_BENCH_DIR "bench"
+#endif
+
+const char* const CORPORA[] = { "easy_9x9", "hard_9x9", "adversarial_9x9", "12x12", "16x16", "25x25", "36x36", "49x49" };
+
+struct Corpus {
+    string name;
+    vector<Grid> boards;
+};
+
+struct BenchResult {
+    string corpus;
+    string engine;
+    size_t puzzles = 0;
+    size_t solved = 0;
+    size_t limited = 0;         //Stopped by the node limit
+    size_t wrong = 0;           //Reported solved but the board is not a valid solution
+    double seconds = 0;
+    bool hasLatency = true;     //False for batch runs that are only timed as a whole
+    double p50 = 0, p99 = 0, maxLatency = 0;    //Microseconds
+    double nodesMean = 0;
+    uint64_t nodesMax = 0;
+};
+
+//Runs one board; returns whether it was solved (or accepted) and the nodes it took
+typedef function<bool(Grid& board, SolveControl& control)> BenchEngine;
+
+struct EngineEntry {
+    const char* name;
+    BenchEngine run;
+};
+
+static bool loadCorpus(const string& path, Corpus& corpus) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    LineReader reader(file);
+    const char* line;
+    size_t length;
+    Grid grid;
+    while (reader.next(line, length)) {
+        if (puzzleField(line, length) && parsePuzzle(line, length, grid))
+            corpus.boards.push_back(grid);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool isSolution(const Grid& board) {
+    for (int cell = 0; cell < board.size(); cell++)
+        if (board.cells[cell] == 0)
+            return false;
+    return isValidSudoku(board);
+}
+
+static double percentile(const vector<double>& sorted, double fraction) {
+    if (sorted.empty())
+        return 0;
+    size_t index = (size_t)(fraction * sorted.size());
+    return sorted[min(index, sorted.size() - 1)];
+}
+
+static BenchResult runEngine(const Corpus& corpus, const EngineEntry& engine, int repeat,
+                             uint64_t nodeLimit, bool checkSolution) {
+    BenchResult result;
+    result.corpus = corpus.name;
+    result.engine = engine.name;
+
+    vector<double> latencies;
+    uint64_t totalNodes = 0;
+    Grid board;
+    SolveControl control;
+    for (int r = 0; r < repeat; r++) {
+        for (size_t k = 0; k < corpus.boards.size(); k++) {
+            board.copyFrom(corpus.boards[k]);
+            control.reset();
+            control.nodeLimit = nodeLimit;
+
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            bool solved = engine.run(board, control);
+            double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+            uint64_t nodes = control.nodes.load();
+            result.puzzles++;
+            if (solved) {
+                result.solved++;
+                if (checkSolution && !isSolution(board))
+                    result.wrong++;
+            } else if (nodeLimit != 0 && nodes >= nodeLimit) {
+                result.limited++;
+            }
+            latencies.push_back(micros);
+            result.seconds += micros / 1e6;
+            totalNodes += nodes;
+            result.nodesMax = max(result.nodesMax, nodes);
+        }
+    }
+
+    sort(latencies.begin(), latencies.end());
+    result.p50 = percentile(latencies, 0.50);
+    result.p99 = percentile(latencies, 0.99);
+    result.maxLatency = latencies.empty() ? 0 : latencies.back();
+    result.nodesMean = result.puzzles ? (double)totalNodes / result.puzzles : 0;
+    return result;
+}
+
+//validateBoards9() over the whole corpus, timed as one call per repeat
+static BenchResult runBatchValidate(const Corpus& corpus, int repeat) {
+    BenchResult result;
+    result.corpus = corpus.name;
+    result.engine = "validate_batch";
+    result.hasLatency = false;
+
+    vector<uint8_t> boards, valid(corpus.boards.size());
+    for (size_t k = 0; k < corpus.boards.size(); k++)
+        boards.insert(boards.end(), corpus.boards[k].cells.begin(), corpus.boards[k].cells.end());
+    for (int r = 0; r < repeat; r++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        validateBoards9(boards.data(), corpus.boards.size(), valid.data());
+        result.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        result.puzzles += corpus.boards.size();
+        for (size_t k = 0; k < valid.size(); k++)
+            result.solved += valid[k];
+    }
+    return result;
+}
+
+static string jsonString(const string& text) {
+    string out = "\"";
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '"' || text[i] == '\\')
+            out += '\\';
+        out += text[i];
+    }
+    return out + "\"";
+}
+
+static void writeJson(FILE* out, const vector<BenchResult>& results, int repeat, uint64_t nodeLimit) {
+    fprintf(out, "{\n  \"repeat\": %d,\n  \"node_limit\": %llu,\n  \"validate_kernel\": %s,\n  \"results\": [\n",
+            repeat, (unsigned long long)nodeLimit, jsonString(validateKernelName()).c_str());
+    for (size_t k = 0; k < results.size(); k++) {
+        const BenchResult& r = results[k];
+        fprintf(out, "    {\"corpus\": %s, \"engine\": %s, \"puzzles\": %zu, \"solved\": %zu, \"limited\": %zu, "
+                     "\"wrong\": %zu, \"seconds\": %.6f, \"puzzles_per_sec\": %.1f, ",
+                jsonString(r.corpus).c_str(), jsonString(r.engine).c_str(), r.puzzles, r.solved, r.limited,
+                r.wrong, r.seconds, r.seconds > 0 ? r.puzzles / r.seconds : 0.0);
+        if (r.hasLatency)
+            fprintf(out, "\"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f, ", r.p50, r.p99, r.maxLatency);
+        else
+            fprintf(out, "\"p50_us\": null, \"p99_us\": null, \"max_us\": null, ");
+        fprintf(out, "\"nodes_mean\": %.1f, \"nodes_max\": %llu}%s\n",
+                r.nodesMean, (unsigned long long)r.nodesMax, k + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void printTable(FILE* out, const vector<BenchResult>& results) {
+    fprintf(out, "%-16s %-15s %8s %8s %8s %12s %10s %10s %11s %13s\n",
+            "corpus", "engine", "puzzles", "solved", "limited", "puzzles/s", "p50 us", "p99 us", "max us", "nodes/puzzle");
+    for (size_t k = 0; k < results.size(); k++) {
+        const BenchResult& r = results[k];
+        fprintf(out, "%-16s %-15s %8zu %8zu %8zu %12.0f ", r.corpus.c_str(), r.engine.c_str(),
+                r.puzzles, r.solved, r.limited, r.seconds > 0 ? r.puzzles / r.seconds : 0.0);
+        if (r.hasLatency)
+            fprintf(out, "%10.1f %10.1f %11.1f ", r.p50, r.p99, r.maxLatency);
+        else
+            fprintf(out, "%10s %10s %11s ", "-", "-", "-");
+        fprintf(out, "%13.1f%s\n", r.nodesMean, r.wrong ? "  WRONG SOLUTIONS" : "");
+    }
+}
+
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [--corpus DIR] [--engine NAME[,NAME...]] [--repeat R] [--node-limit N] [--json FILE|-]" << endl;
+    cerr << "Engines: backtrack propagate dlx unique cached canonical validate validate_batch" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    string corpusDir = SUDOKU_BENCH_DIR;
+    string engineFilter;
+    string jsonPath;
+    int repeat = 1;
+    uint64_t nodeLimit = 1 << 22;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--corpus" && i + 1 < argc) {
+            corpusDir = argv[++i];
+        } else if (arg == "--engine" && i + 1 < argc) {
+            engineFilter = string(",") + argv[++i] + ",";
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = max(1, atoi(argv[++i]));
+        } else if (arg == "--node-limit" && i + 1 < argc) {
+            nodeLimit = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    //backtrack is the row-major order of solveSudoku(); unique is countSolutions() with limit 2.
+    //cached is propagate behind a SolveCache kept across repeats (so --repeat 2
+    //times hits), canonical only computes the cache key.
+    SolveCache cache;
+    const EngineEntry engines[] = {
+        { "backtrack", [](Grid& board, SolveControl& control) { return solveSudokuWith(board, SOLVE_BACKTRACK, &control); } },
+        { "propagate", [](Grid& board, SolveControl& control) { return solveSudokuWith(board, SOLVE_PROPAGATE, &control); } },
+        { "dlx", [](Grid& board, SolveControl& control) { return solveSudokuWith(board, SOLVE_DLX, &control); } },
+        { "unique", [](Grid& board, SolveControl& control) { return countSolutions(board, 2, &control) == 1; } },
+        { "cached", [&cache](Grid& board, SolveControl& control) { return cache.solve(board, SOLVE_PROPAGATE, &control); } },
+        { "canonical", [](Grid& board, SolveControl&) {
+            static string key;
+            static BoardTransform transform;
+            canonicalizeBoard(board, key, transform);
+            return true;
+        } },
+        { "validate", [](Grid& board, SolveControl&) { return isValidSudoku(board); } },
+    };
+    auto selected = [&](const char* name) {
+        return engineFilter.empty() || engineFilter.find(string(",") + name + ",") != string::npos;
+    };
+
+    vector<BenchResult> results;
+    for (const char* name : CORPORA) {
+        Corpus corpus;
+        corpus.name = name;
+        string path = corpusDir + "/" + name + ".txt";
+        if (!loadCorpus(path, corpus)) {
+            cerr << "Cannot open " << path << endl;
+            return 1;
+        }
+        for (const EngineEntry& engine : engines) {
+            if (!selected(engine.name))
+                continue;
+            bool checkSolution = strcmp(engine.name, "validate") != 0 && strcmp(engine.name, "canonical") != 0;
+            results.push_back(runEngine(corpus, engine, repeat, nodeLimit, checkSolution));
+        }
+        if (selected("validate_batch") && !corpus.boards.empty() && corpus.boards[0].N == 9)
+            results.push_back(runBatchValidate(corpus, repeat));
+    }
+
+    if (jsonPath == "-") {
+        writeJson(stdout, results, repeat, nodeLimit);
+        return 0;
+    }
+    printTable(stdout, results);
+    if (!jsonPath.empty()) {
+        FILE* out = fopen(jsonPath.c_str(), "w");
+        if (out == nullptr) {
+            cerr << "Cannot write " << jsonPath << endl;
+            return 1;
+        }
+        writeJson(out, results, repeat, nodeLimit);
+        fclose(out);
+    }
+    return 0;
+}
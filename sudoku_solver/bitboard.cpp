@@ -0,0 +1,69 @@
+#include "bitboard.h"
+using namespace std;
+
+void BitboardSolver::resize(const BoardGeometry& shape) {
+    if (shape != geometry) {
+        geometry = shape;
+        N = shape.N;
+        allDigits = (N >= MAX_MASK_DIGITS) ? ~DigitMask(0) : ((DigitMask(1) << N) - 1);
+        rowOf.resize(N * N);
+        colOf.resize(N * N);
+        boxOf.resize(N * N);
+        for (int cell = 0; cell < N * N; cell++) {
+            int row = cell / N;
+            int col = cell % N;
+            rowOf[cell] = row;
+            colOf[cell] = col;
+            //Without boxes the row doubles as the box, which adds no constraint
+            boxOf[cell] = geometry.hasBoxes() ? geometry.boxOf(row, col) : row;
+        }
+    }
+
+    cells.assign(N * N, 0);
+    rowUsed.assign(N, 0);
+    colUsed.assign(N, 0);
+    boxUsed.assign(N, 0);
+    empties.clear();
+    nodes = 0;
+    cancelled = false;
+}
+
+void BitboardSolver::loadCells(const uint8_t* flat, const BoardGeometry& shape, int startCell) {
+    resize(shape);
+    for (int cell = 0; cell < N * N; cell++)
+        loadCell(cell, flat[cell], startCell);
+}
+
+void BitboardSolver::store(Grid& grid) const {
+    for (size_t k = 0; k < empties.size(); k++) {
+        int cell = empties[k];
+        grid.cells[cell] = cells[cell];
+    }
+}
+
+bool BitboardSolver::search(size_t k) {
+    nodes++;
+    if (cancelled || pollControl(control, nodes, (int)k)) {
+        cancelled = true;
+        return false;
+    }
+    if (k == empties.size())
+        return true;
+
+    SOLVE_DEPTH(stats, k + 1);
+    int cell = empties[k];
+    DigitMask options = candidates(cell);
+    while (options) {
+        int num = lowestDigit(options);
+        options &= options - 1;
+        SOLVE_COUNT(stats, guesses);
+        SOLVE_TRACE(trace, branch(nodes, cell, num, (int)k));
+        place(cell, num);
+        if (search(k + 1))
+            return true;
+        remove(cell, num);
+        SOLVE_COUNT(stats, backtracks);
+        SOLVE_TRACE(trace, undo(nodes, (int)k));
+    }
+    return false;
+}
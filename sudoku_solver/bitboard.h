@@ -0,0 +1,92 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "grid.h"
+#include "solve_control.h"
+#include "solve_stats.h"
+
+//Set of digits: bit (d - 1) stands for digit d
+typedef uint64_t DigitMask;
+
+//Largest N whose digits fit in a DigitMask
+const int MAX_MASK_DIGITS = 64;
+
+//Backtracking engine that keeps the used digits of every row, column and block
+//as bitsets. Checking a digit is a single AND and placing one is O(1), instead of
+//the O(N) scans isSafe() does.
+struct BitboardSolver {
+    int N = 0;
+    BoardGeometry geometry;
+    DigitMask allDigits = 0;
+
+    std::vector<uint8_t> cells; //Row-major copy of the board
+    std::vector<int> rowOf, colOf, boxOf;
+    std::vector<DigitMask> rowUsed, colUsed, boxUsed;
+    std::vector<int> empties;   //Cells left to fill, in search order
+
+    uint64_t nodes = 0;         //search() calls since load()
+    SolveControl* control = nullptr;
+    bool cancelled = false;
+    SolveStats* stats = nullptr;    //Instrumented builds count into these
+    SolveTrace* trace = nullptr;
+
+    //Copies the board and rebuilds the masks. Only empty cells at or after
+    //startCell (row-major) are searched. Buffers are reused between calls.
+    void load(const Grid& grid, int startCell = 0) { loadCells(grid.data(), grid.geometry, startCell); }
+    //Same from a row-major array of N*N cells
+    void loadCells(const uint8_t* flat, const BoardGeometry& geometry, int startCell = 0);
+    //Writes the searched cells back
+    void store(Grid& grid) const;
+
+    //Builds the cell lookup tables when the geometry changes and clears the masks
+    void resize(const BoardGeometry& geometry);
+    //Records one loaded cell value
+    void loadCell(int cell, int num, int startCell) {
+        if (num > 0) {
+            cells[cell] = num;
+            //Out of range values can never clash with a digit 1..N
+            if (num <= N)
+                place(cell, num);
+        } else if (cell >= startCell) {
+            empties.push_back(cell);
+        }
+    }
+
+    DigitMask candidates(int cell) const {
+        SOLVE_COUNT(stats, candidateChecks);
+        return allDigits & ~(rowUsed[rowOf[cell]] | colUsed[colOf[cell]] | boxUsed[boxOf[cell]]);
+    }
+
+    void place(int cell, int num) {
+        DigitMask bit = DigitMask(1) << (num - 1);
+        cells[cell] = num;
+        rowUsed[rowOf[cell]] |= bit;
+        colUsed[colOf[cell]] |= bit;
+        boxUsed[boxOf[cell]] |= bit;
+    }
+
+    void remove(int cell, int num) {
+        DigitMask bit = DigitMask(1) << (num - 1);
+        cells[cell] = 0;
+        rowUsed[rowOf[cell]] &= ~bit;
+        colUsed[colOf[cell]] &= ~bit;
+        boxUsed[boxOf[cell]] &= ~bit;
+    }
+
+    //Fills empties[k..] trying digits in increasing order, same as solveSudoku()
+    bool search(size_t k);
+    bool solve() { return search(0); }
+};
+
+inline int lowestDigit(DigitMask mask) {
+    return __builtin_ctzll(mask) + 1;
+}
+
+inline int countDigits(DigitMask mask) {
+    return __builtin_popcountll(mask);
+}
+
+#endif // BITBOARD_H
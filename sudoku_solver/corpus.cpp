@@ -0,0 +1,292 @@
+#include "corpus.h"
+#include "puzzle_io.h"
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+const char CORPUS_MAGIC[4] = { 'S', 'D', 'K', 'B' };
+const uint32_t CORPUS_VERSION = 2;
+const int MAX_NIBBLE_DIGITS = 15;
+
+static void putU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void putU64(uint8_t* out, uint64_t value) {
+    putU32(out, (uint32_t)value);
+    putU32(out + 4, (uint32_t)(value >> 32));
+}
+
+static uint32_t getU32(const uint8_t* in) {
+    return in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+static uint64_t getU64(const uint8_t* in) {
+    return getU32(in) | (uint64_t)getU32(in + 4) << 32;
+}
+
+CorpusFormat CorpusFormat::forBoard(const BoardGeometry& geometry, bool bytePacked, uint32_t sections) {
+    uint32_t flags = sections & (CORPUS_SOLUTIONS | CORPUS_STATS);
+    if (!bytePacked && geometry.N <= MAX_NIBBLE_DIGITS)
+        flags |= CORPUS_NIBBLES;
+    return CorpusFormat(geometry, flags);
+}
+
+void CorpusFormat::pack(const uint8_t* cells, uint8_t* out) const {
+    int count = N * N;
+    if (!(flags & CORPUS_NIBBLES)) {
+        memcpy(out, cells, count);
+        return;
+    }
+    int k = 0;
+    for (; k + 1 < count; k += 2)
+        *out++ = (uint8_t)((cells[k] & 15) | (cells[k + 1] << 4));
+    if (k < count)
+        *out = cells[k] & 15;
+}
+
+void CorpusFormat::unpack(const uint8_t* in, uint8_t* cells) const {
+    int count = N * N;
+    if (!(flags & CORPUS_NIBBLES)) {
+        memcpy(cells, in, count);
+        return;
+    }
+    int k = 0;
+    for (; k + 1 < count; k += 2, in++) {
+        cells[k] = *in & 15;
+        cells[k + 1] = *in >> 4;
+    }
+    if (k < count)
+        cells[k] = *in & 15;
+}
+
+void CorpusFormat::writeStats(uint8_t* record, int status, uint64_t nodes) const {
+    uint8_t* stats = record + statsOffset();
+    memset(stats, 0, CORPUS_STATS_SIZE);
+    stats[0] = (uint8_t)status;
+    putU64(stats + 8, nodes);
+}
+
+void CorpusFormat::writeHeader(uint8_t* header, uint64_t count) const {
+    memset(header, 0, CORPUS_HEADER_SIZE);
+    memcpy(header, CORPUS_MAGIC, 4);
+    putU32(header + 4, CORPUS_VERSION);
+    putU32(header + 8, N);
+    putU32(header + 12, flags);
+    putU64(header + 16, count);
+    putU32(header + 24, (uint32_t)recordSize());
+    header[28] = (uint8_t)geometry.boxRows;
+    header[29] = (uint8_t)geometry.boxCols;
+}
+
+bool CorpusReader::isCorpus(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+        return false;
+    char magic[4];
+    bool found = fread(magic, 1, 4, file) == 4 && memcmp(magic, CORPUS_MAGIC, 4) == 0;
+    fclose(file);
+    return found;
+}
+
+bool CorpusReader::open(const char* path, string* error) {
+    close();
+    auto fail = [&](const char* reason) {
+        if (error != nullptr)
+            *error = reason;
+        close();
+        return false;
+    };
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return fail("cannot open file");
+    fileHandle = file;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+        return fail("cannot read file size");
+    length = (size_t)fileSize.QuadPart;
+    if (length < CORPUS_HEADER_SIZE)
+        return fail("file is too short");
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+        return fail("cannot map file");
+    base = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (base == nullptr)
+        return fail("cannot map file");
+#else
+    descriptor = ::open(path, O_RDONLY);
+    if (descriptor < 0)
+        return fail("cannot open file");
+    struct stat info;
+    if (fstat(descriptor, &info) != 0)
+        return fail("cannot read file size");
+    length = (size_t)info.st_size;
+    if (length < CORPUS_HEADER_SIZE)
+        return fail("file is too short");
+    void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (view == MAP_FAILED)
+        return fail("cannot map file");
+    base = (const uint8_t*)view;
+    madvise(view, length, MADV_SEQUENTIAL);
+#endif
+
+    if (memcmp(base, CORPUS_MAGIC, 4) != 0)
+        return fail("not a puzzle corpus");
+    uint32_t version = getU32(base + 4);
+    if (version != 1 && version != CORPUS_VERSION)
+        return fail("unsupported corpus version");
+    layout = CorpusFormat((int)getU32(base + 8), getU32(base + 12));
+    if (layout.N <= 0 || layout.N > MAX_PUZZLE_DIGITS || ((layout.flags & CORPUS_NIBBLES) && layout.N > MAX_NIBBLE_DIGITS))
+        return fail("bad board size");
+    if (version != 1) {
+        BoardGeometry& shape = layout.geometry;
+        shape = BoardGeometry(layout.N, base[28], base[29]);
+        if ((shape.boxRows == 0) != (shape.boxCols == 0) || shape.boxRows * shape.boxCols != (shape.hasBoxes() ? layout.N : 0))
+            return fail("box shape does not fit the board size");
+    }
+    if (layout.flags & ~uint32_t(CORPUS_NIBBLES | CORPUS_SOLUTIONS | CORPUS_STATS))
+        return fail("unknown corpus flags");
+    if (getU32(base + 24) != layout.recordSize())
+        return fail("record size does not match the header");
+
+    //An unknown count (a writer that could not seek) means up to the end
+    uint64_t available = (length - CORPUS_HEADER_SIZE) / layout.recordSize();
+    records = getU64(base + 16);
+    if (records == CORPUS_UNKNOWN_COUNT)
+        records = available;
+    if (records > available)
+        return fail("file is truncated");
+    return true;
+}
+
+void CorpusReader::close() {
+#ifdef _WIN32
+    if (base != nullptr)
+        UnmapViewOfFile(base);
+    if (mapping != nullptr)
+        CloseHandle(mapping);
+    if (fileHandle != nullptr)
+        CloseHandle(fileHandle);
+    mapping = nullptr;
+    fileHandle = nullptr;
+#else
+    if (base != nullptr)
+        munmap((void*)base, length);
+    if (descriptor >= 0)
+        ::close(descriptor);
+    descriptor = -1;
+#endif
+    base = nullptr;
+    length = 0;
+    records = 0;
+    layout = CorpusFormat();
+}
+
+void CorpusReader::puzzle(uint64_t k, Grid& grid) const {
+    if (grid.geometry != layout.geometry)
+        grid.resize(layout.geometry);
+    layout.unpack(record(k), grid.data());
+}
+
+bool CorpusReader::solution(uint64_t k, Grid& grid) const {
+    if (!(layout.flags & CORPUS_SOLUTIONS))
+        return false;
+    if (grid.geometry != layout.geometry)
+        grid.resize(layout.geometry);
+    layout.unpack(record(k) + layout.solutionOffset(), grid.data());
+    return true;
+}
+
+bool CorpusReader::stats(uint64_t k, int& status, uint64_t& nodes) const {
+    if (!(layout.flags & CORPUS_STATS))
+        return false;
+    const uint8_t* section = record(k) + layout.statsOffset();
+    status = section[0];
+    nodes = getU64(section + 8);
+    return true;
+}
+
+bool CorpusWriter::begin(FILE* out, const CorpusFormat& recordFormat) {
+    file = out;
+    format = recordFormat;
+    written = 0;
+    record.assign(format.recordSize(), 0);
+    uint8_t header[CORPUS_HEADER_SIZE];
+    format.writeHeader(header, CORPUS_UNKNOWN_COUNT);
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+bool CorpusWriter::appendRecords(const uint8_t* records, size_t count) {
+    size_t bytes = count * format.recordSize();
+    if (fwrite(records, 1, bytes, file) != bytes)
+        return false;
+    written += count;
+    return true;
+}
+
+bool CorpusWriter::append(const uint8_t* cells, const uint8_t* solution, int status, uint64_t nodes) {
+    format.pack(cells, record.data());
+    if (format.flags & CORPUS_SOLUTIONS) {
+        if (solution != nullptr)
+            format.pack(solution, record.data() + format.solutionOffset());
+        else
+            memset(record.data() + format.solutionOffset(), 0, format.cellBytes());
+    }
+    if (format.flags & CORPUS_STATS)
+        format.writeStats(record.data(), status, nodes);
+    return appendRecords(record.data(), 1);
+}
+
+bool CorpusWriter::finish() {
+    if (fflush(file) != 0)
+        return false;
+    //Pipes cannot seek; readers then count the records from the file size
+    long end = ftell(file);
+    if (end < 0 || fseek(file, 0, SEEK_SET) != 0)
+        return true;
+    uint8_t header[CORPUS_HEADER_SIZE];
+    format.writeHeader(header, written);
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    fseek(file, end, SEEK_SET);
+    return ok && fflush(file) == 0;
+}
+
+bool convertPuzzles(FILE* in, FILE* out, bool bytePacked, const BoardGeometry& boxes, uint64_t& converted,
+                    uint64_t& skipped) {
+    converted = 0;
+    skipped = 0;
+    LineReader reader(in);
+    CorpusWriter writer;
+    Grid grid;
+    const char* line;
+    size_t length;
+    while (reader.next(line, length)) {
+        if (!puzzleField(line, length))
+            continue;
+        if (!parsePuzzle(line, length, grid) || (converted > 0 && grid.N != writer.format.N)) {
+            skipped++;
+            continue;
+        }
+        if (converted == 0
+            && !writer.begin(out, CorpusFormat::forBoard(grid.N == boxes.N ? boxes : grid.geometry, bytePacked)))
+            return false;
+        if (!writer.append(grid.data()))
+            return false;
+        converted++;
+    }
+    //An input without puzzles still gives a valid, empty corpus
+    if (converted == 0 && !writer.begin(out, CorpusFormat::forBoard(BoardGeometry::standard(9), bytePacked)))
+        return false;
+    return writer.finish();
+}
@@ -0,0 +1,132 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "grid.h"
+
+//Binary puzzle corpus: a 32-byte header followed by fixed-size records, so
+//record k sits at 32 + k * recordSize and a mapped file can be split into
+//chunks without scanning it.
+//
+//  header  "SDKB", version, N, flags, count (u64, all ones when unknown),
+//          record size, box rows and box columns (one byte each, both 0
+//          for a board without boxes), 2 reserved bytes; integers
+//          little-endian. Version 1 files have no box shape and read as
+//          having the standard one.
+//  record  puzzle cells, then the solution cells when CORPUS_SOLUTIONS,
+//          then 16 stats bytes when CORPUS_STATS: the PuzzleStatus in byte 0
+//          and the search nodes as a u64 in bytes 8..15
+//
+//Cells are one byte each, or two per byte (low nibble first) with
+//CORPUS_NIBBLES, which needs N <= 15 and halves a 9x9 record to 41 bytes.
+enum CorpusFlags {
+    CORPUS_NIBBLES = 1,
+    CORPUS_SOLUTIONS = 2,
+    CORPUS_STATS = 4
+};
+
+const size_t CORPUS_HEADER_SIZE = 32;
+const size_t CORPUS_STATS_SIZE = 16;
+const uint64_t CORPUS_UNKNOWN_COUNT = ~uint64_t(0);
+
+//Record layout for one board shape and set of flags
+struct CorpusFormat {
+    int N = 0;
+    uint32_t flags = 0;
+    BoardGeometry geometry;
+
+    CorpusFormat() {}
+    CorpusFormat(int N, uint32_t flags) : N(N), flags(flags), geometry(BoardGeometry::standard(N)) {}
+    CorpusFormat(const BoardGeometry& geometry, uint32_t flags) : N(geometry.N), flags(flags), geometry(geometry) {}
+
+    //Nibbles when the board allows them and byte packing was not asked for
+    static CorpusFormat forBoard(const BoardGeometry& geometry, bool bytePacked, uint32_t sections = 0);
+
+    size_t cellBytes() const { return (flags & CORPUS_NIBBLES) ? (N * N + 1) / 2 : N * N; }
+    size_t recordSize() const {
+        return cellBytes() * ((flags & CORPUS_SOLUTIONS) ? 2 : 1) + ((flags & CORPUS_STATS) ? CORPUS_STATS_SIZE : 0);
+    }
+    size_t solutionOffset() const { return cellBytes(); }
+    size_t statsOffset() const { return cellBytes() * ((flags & CORPUS_SOLUTIONS) ? 2 : 1); }
+
+    //N*N cells to and from cellBytes() bytes
+    void pack(const uint8_t* cells, uint8_t* out) const;
+    void unpack(const uint8_t* in, uint8_t* cells) const;
+    //Fills the stats section of a record
+    void writeStats(uint8_t* record, int status, uint64_t nodes) const;
+
+    void writeHeader(uint8_t* header, uint64_t count) const;
+};
+
+//Read-only view of a corpus file mapped into memory. Records are read
+//straight from the mapping; with byte packing a board needs no copy at all.
+class CorpusReader {
+public:
+    CorpusReader() {}
+    ~CorpusReader() { close(); }
+    CorpusReader(const CorpusReader&) = delete;
+    CorpusReader& operator=(const CorpusReader&) = delete;
+
+    //Maps the file and checks its header; error receives the reason on failure
+    bool open(const char* path, std::string* error = nullptr);
+    void close();
+
+    const CorpusFormat& format() const { return layout; }
+    int size() const { return layout.N; }
+    uint64_t count() const { return records; }
+
+    const uint8_t* record(uint64_t k) const { return base + CORPUS_HEADER_SIZE + k * layout.recordSize(); }
+    //Cells of puzzle k in place, or nullptr when the corpus is nibble-packed
+    const uint8_t* puzzleCells(uint64_t k) const {
+        return (layout.flags & CORPUS_NIBBLES) ? nullptr : record(k);
+    }
+    //Unpacks puzzle k (or its stored solution) into the grid, with the corpus's box shape
+    void puzzle(uint64_t k, Grid& grid) const;
+    bool solution(uint64_t k, Grid& grid) const;
+    //Status and nodes from the stats section; false without one
+    bool stats(uint64_t k, int& status, uint64_t& nodes) const;
+
+    //True when the file starts with the corpus magic
+    static bool isCorpus(const char* path);
+
+private:
+    CorpusFormat layout;
+    uint64_t records = 0;
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mapping = nullptr;
+#else
+    int descriptor = -1;
+#endif
+};
+
+//Streams records into a file. The header is written first with an unknown
+//count, and finish() fills in the real one when the file can seek.
+struct CorpusWriter {
+    FILE* file = nullptr;
+    CorpusFormat format;
+    uint64_t written = 0;
+    std::vector<uint8_t> record;
+
+    bool begin(FILE* file, const CorpusFormat& format);
+    //Appends whole records packed by the caller
+    bool appendRecords(const uint8_t* records, size_t count);
+    //Packs one board (solution may be null; it is zeroed) and appends it
+    bool append(const uint8_t* cells, const uint8_t* solution = nullptr, int status = 0, uint64_t nodes = 0);
+    bool finish();
+};
+
+//Text to binary: packs every puzzle line of in (blank lines and '#' comments
+//skipped) into a corpus of puzzles only. N comes from the first puzzle; lines
+//that do not parse or have another size are skipped and counted. A board of
+//size boxes.N is recorded with that box shape, any other with the standard one.
+bool convertPuzzles(FILE* in, FILE* out, bool bytePacked, const BoardGeometry& boxes, uint64_t& converted,
+                    uint64_t& skipped);
+
+#endif // CORPUS_H
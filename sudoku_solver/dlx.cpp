@@ -0,0 +1,219 @@
+#include "dlx.h"
+#include "sudoku.h"
+#include <map>
+using namespace std;
+
+void DlxMatrix::build(const BoardGeometry& shape) {
+    geometry = shape;
+    N = shape.N;
+    int constraints = geometry.hasBoxes() ? 4 : 3;
+    columns = constraints * N * N;
+    int rows = N * N * N;
+
+    nodes.assign(1 + columns + rows * constraints, Node());
+    columnSize.assign(columns + 1, 0);
+    rowStart.assign(rows, 0);
+    chosen.clear();
+    chosen.reserve(N * N);
+    coveredStack.clear();
+
+    //Root and column headers in one circular list
+    for (int c = 0; c <= columns; c++) {
+        nodes[c].left = (c == 0) ? columns : c - 1;
+        nodes[c].right = (c == columns) ? 0 : c + 1;
+        nodes[c].up = c;
+        nodes[c].down = c;
+        nodes[c].column = c;
+        nodes[c].row = -1;
+    }
+
+    int next = columns + 1;
+    for (int cell = 0; cell < N * N; cell++) {
+        int row = cell / N;
+        int col = cell % N;
+        int box = geometry.hasBoxes() ? geometry.boxOf(row, col) : 0;
+        for (int d = 0; d < N; d++) {
+            int id = cell * N + d;
+            int hit[4] = {
+                1 + cell,
+                1 + N * N + row * N + d,
+                1 + 2 * N * N + col * N + d,
+                1 + 3 * N * N + box * N + d
+            };
+            rowStart[id] = next;
+            for (int k = 0; k < constraints; k++) {
+                int node = next + k;
+                int header = hit[k];
+                nodes[node].left = next + (k + constraints - 1) % constraints;
+                nodes[node].right = next + (k + 1) % constraints;
+                nodes[node].column = header;
+                nodes[node].row = id;
+                nodes[node].up = nodes[header].up;
+                nodes[node].down = header;
+                nodes[nodes[header].up].down = node;
+                nodes[header].up = node;
+                columnSize[header]++;
+            }
+            next += constraints;
+        }
+    }
+}
+
+void DlxMatrix::cover(int column) {
+    Node* n = nodes.data();
+    n[n[column].right].left = n[column].left;
+    n[n[column].left].right = n[column].right;
+    for (int i = n[column].down; i != column; i = n[i].down) {
+        for (int j = n[i].right; j != i; j = n[j].right) {
+            n[n[j].down].up = n[j].up;
+            n[n[j].up].down = n[j].down;
+            columnSize[n[j].column]--;
+        }
+    }
+}
+
+void DlxMatrix::uncover(int column) {
+    Node* n = nodes.data();
+    for (int i = n[column].up; i != column; i = n[i].up) {
+        for (int j = n[i].left; j != i; j = n[j].left) {
+            columnSize[n[j].column]++;
+            n[n[j].down].up = j;
+            n[n[j].up].down = j;
+        }
+    }
+    n[n[column].right].left = column;
+    n[n[column].left].right = column;
+}
+
+void DlxMatrix::select(int row) {
+    int start = rowStart[row];
+    cover(nodes[start].column);
+    for (int j = nodes[start].right; j != start; j = nodes[j].right)
+        cover(nodes[j].column);
+}
+
+void DlxMatrix::deselect(int row) {
+    int start = rowStart[row];
+    for (int j = nodes[start].left; j != start; j = nodes[j].left)
+        uncover(nodes[j].column);
+    uncover(nodes[start].column);
+}
+
+bool DlxMatrix::search() {
+    nodesVisited++;
+    if (cancelled || pollControl(control, nodesVisited, (int)chosen.size())) {
+        cancelled = true;
+        return false;
+    }
+    Node* n = nodes.data();
+    if (n[0].right == 0)
+        return true;
+
+    //Minimum remaining values: branch on the column with the fewest rows
+    int best = n[0].right;
+    for (int c = n[best].right; c != 0 && columnSize[best] > 1; c = n[c].right) {
+        SOLVE_COUNT(stats, candidateChecks);
+        if (columnSize[c] < columnSize[best])
+            best = c;
+    }
+    if (columnSize[best] == 0)
+        return false;
+
+    SOLVE_DEPTH(stats, chosen.size() + 1);
+    cover(best);
+    for (int r = n[best].down; r != best; r = n[r].down) {
+        SOLVE_COUNT(stats, guesses);
+        SOLVE_TRACE(trace, branch(nodesVisited, n[r].row / N, n[r].row % N + 1, (int)chosen.size()));
+        chosen.push_back(n[r].row);
+        for (int j = n[r].right; j != r; j = n[j].right)
+            cover(n[j].column);
+        bool found = search();
+        for (int j = n[r].left; j != r; j = n[j].left)
+            uncover(n[j].column);
+        if (found) {
+            uncover(best);
+            return true;
+        }
+        chosen.pop_back();
+        SOLVE_COUNT(stats, backtracks);
+        SOLVE_TRACE(trace, undo(nodesVisited, (int)chosen.size()));
+    }
+    uncover(best);
+    return false;
+}
+
+bool DlxMatrix::solve(Grid& grid) {
+    chosen.clear();
+    coveredStack.clear();
+    nodesVisited = 0;
+    cancelled = false;
+    SolveClock::time_point started;
+    if (stats != nullptr)
+        started = SolveClock::now();
+
+    //Givens: select their rows. A header that is already unlinked means two
+    //givens claim the same constraint. Out of range values only fill the cell,
+    //recorded as ~column so they can be told apart from rows.
+    bool clash = false;
+    for (int cell = 0; cell < N * N && !clash; cell++) {
+        int num = grid.cells[cell];
+        if (num <= 0)
+            continue;
+        if (num > N) {
+            int header = 1 + cell;
+            if (nodes[nodes[header].left].right != header) {
+                clash = true;
+            } else {
+                cover(header);
+                coveredStack.push_back(~header);
+            }
+            continue;
+        }
+        int row = cell * N + num - 1;
+        int start = rowStart[row];
+        int j = start;
+        do {
+            int header = nodes[j].column;
+            if (nodes[nodes[header].left].right != header)
+                clash = true;
+            j = nodes[j].right;
+        } while (j != start && !clash);
+        if (!clash) {
+            select(row);
+            coveredStack.push_back(row);
+        }
+    }
+
+    if (stats != nullptr) {
+        stats->loadSeconds += secondsSince(started);
+        started = SolveClock::now();
+    }
+    bool found = !clash && search();
+    if (stats != nullptr)
+        stats->searchSeconds += secondsSince(started);
+    if (found) {
+        for (size_t k = 0; k < chosen.size(); k++) {
+            int cell = chosen[k] / N;
+            grid.cells[cell] = chosen[k] % N + 1;
+        }
+    }
+
+    while (!coveredStack.empty()) {
+        int entry = coveredStack.back();
+        coveredStack.pop_back();
+        if (entry < 0)
+            uncover(~entry);
+        else
+            deselect(entry);
+    }
+    return found;
+}
+
+DlxMatrix& dlxMatrixFor(const BoardGeometry& geometry) {
+    //Without boxes boxRows is 0, so (N, boxRows) tells every shape apart
+    static thread_local map<pair<int, int>, DlxMatrix> matrices;
+    DlxMatrix& matrix = matrices[make_pair(geometry.N, geometry.boxRows)];
+    if (matrix.geometry != geometry)
+        matrix.build(geometry);
+    return matrix;
+}
@@ -0,0 +1,54 @@
+#ifndef DLX_H
+#define DLX_H
+
+#include <cstdint>
+#include <vector>
+#include "grid.h"
+#include "solve_control.h"
+#include "solve_stats.h"
+
+//Sudoku as exact cover, solved with Knuth's Dancing Links (Algorithm X).
+//Columns are the cell, row-digit, column-digit and box-digit constraints
+//(4*N*N, or 3*N*N without boxes) and every (cell, digit) pair is a row.
+//All nodes live in one arena; the matrix is built once per board size and
+//every solve leaves it exactly as it found it.
+struct DlxMatrix {
+    struct Node {
+        int left, right, up, down;
+        int column;
+        int row;                //(cell * N + digit - 1), -1 for headers
+    };
+
+    int N = 0;
+    BoardGeometry geometry;
+    int columns = 0;
+    std::vector<Node> nodes;            //[0] root, [1..columns] headers, then rows
+    std::vector<int> columnSize;
+    std::vector<int> rowStart;          //First node of every row
+    std::vector<int> chosen;            //Rows picked by the current search
+    std::vector<int> coveredStack;      //Columns covered by the givens
+
+    uint64_t nodesVisited = 0;
+    SolveControl* control = nullptr;
+    bool cancelled = false;
+    SolveStats* stats = nullptr;    //Instrumented builds count into these
+    SolveTrace* trace = nullptr;
+
+    void build(const BoardGeometry& geometry);
+
+    void cover(int column);
+    void uncover(int column);
+    void select(int row);
+    void deselect(int row);
+
+    bool search();
+
+    //Covers the givens, searches and restores the matrix.
+    //Returns false for clashing givens or when there is no solution.
+    bool solve(Grid& grid);
+};
+
+//Per-thread matrix for boards of that shape, built on first use
+DlxMatrix& dlxMatrixFor(const BoardGeometry& geometry);
+
+#endif // DLX_H
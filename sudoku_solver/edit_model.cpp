@@ -0,0 +1,89 @@
+#include "edit_model.h"
+using namespace std;
+
+void EditModel::reset(const BoardGeometry& geometry) {
+    grid.resize(geometry);
+    units = geometry.hasBoxes() ? 3 * grid.N : 2 * grid.N;
+    counts.assign((size_t)units * grid.N, 0);
+    used.assign(units, 0);
+    repeats = 0;
+}
+
+void EditModel::load(const Grid& board) {
+    reset(board.geometry);
+    for (int row = 0; row < grid.N; row++)
+        for (int col = 0; col < grid.N; col++)
+            set(row, col, board.at(row, col));
+}
+
+int EditModel::unitCell(int unit, int k) const {
+    int N = grid.N;
+    if (unit < N)
+        return grid.rowCell(unit, k);
+    if (unit < 2 * N)
+        return grid.colCell(unit - N, k);
+    return grid.boxCell(unit - 2 * N, k);
+}
+
+void EditModel::count(int unit, int digit, int delta, vector<int>* changed) {
+    uint8_t& n = counts[unit * grid.N + digit - 1];
+    int before = n;
+    n += delta;
+    DigitMask bit = DigitMask(1) << (digit - 1);
+    used[unit] = n > 0 ? used[unit] | bit : used[unit] & ~bit;
+
+    //Only the 1 <-> 2 steps change whether the unit's copies of the digit clash
+    if ((before < 2) == (n < 2))
+        return;
+    repeats += n >= 2 ? 1 : -1;
+    if (changed == nullptr)
+        return;
+    for (int k = 0; k < grid.N; k++) {
+        int cell = unitCell(unit, k);
+        if (grid.cells[cell] == digit)
+            changed->push_back(cell);
+    }
+}
+
+void EditModel::set(int row, int col, int value, vector<int>* changed) {
+    int N = grid.N;
+    int old = grid.at(row, col);
+    if (value < 0 || value > N || value == old)
+        return;
+    int unitOf[3] = { row, N + col, grid.geometry.hasBoxes() ? 2 * N + grid.boxOf(row, col) : -1 };
+
+    //The cell leaves the old digit's counts before it holds the new one, so
+    //each unit scan below sees the board the count describes
+    grid.at(row, col) = 0;
+    for (int u = 0; u < 3 && old != 0; u++)
+        if (unitOf[u] >= 0)
+            count(unitOf[u], old, -1, changed);
+    grid.at(row, col) = value;
+    for (int u = 0; u < 3 && value != 0; u++)
+        if (unitOf[u] >= 0)
+            count(unitOf[u], value, 1, changed);
+    if (changed != nullptr)
+        changed->push_back(row * N + col);
+}
+
+bool EditModel::conflicts(int row, int col) const {
+    int digit = grid.at(row, col);
+    if (digit == 0)
+        return false;
+    int N = grid.N;
+    return unitCount(row, digit) > 1 || unitCount(N + col, digit) > 1 ||
+           (grid.geometry.hasBoxes() && unitCount(2 * N + grid.boxOf(row, col), digit) > 1);
+}
+
+DigitMask EditModel::candidates(int row, int col) const {
+    int N = grid.N;
+    int box = grid.geometry.hasBoxes() ? 2 * N + grid.boxOf(row, col) : -1;
+    DigitMask taken = used[row] | used[N + col] | (box >= 0 ? used[box] : 0);
+    //The cell's own digit is a candidate unless another cell also blocks it
+    int digit = grid.at(row, col);
+    if (digit != 0 && unitCount(row, digit) == 1 && unitCount(N + col, digit) == 1 &&
+        (box < 0 || unitCount(box, digit) == 1))
+        taken &= ~(DigitMask(1) << (digit - 1));
+    DigitMask all = N >= MAX_MASK_DIGITS ? ~DigitMask(0) : ((DigitMask(1) << N) - 1);
+    return all & ~taken;
+}
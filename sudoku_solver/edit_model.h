@@ -0,0 +1,55 @@
+#ifndef EDIT_MODEL_H
+#define EDIT_MODEL_H
+
+#include <cstdint>
+#include <vector>
+#include "bitboard.h"
+#include "grid.h"
+
+//Board being typed in, with how often each digit appears in every row, column
+//and box kept up to date. An edit changes two counts per unit in O(1), so
+//conflicts, candidates and the validity of the whole board are known after
+//every keystroke without rescanning, even on 64x64 boards.
+class EditModel {
+public:
+    EditModel() {}
+    explicit EditModel(const BoardGeometry& geometry) { reset(geometry); }
+
+    //Empties the board and takes on the shape
+    void reset(const BoardGeometry& geometry);
+    void clear() { reset(grid.geometry); }
+    //Copies a board of the same shape and recounts, O(N*N)
+    void load(const Grid& board);
+
+    const Grid& board() const { return grid; }
+    int size() const { return grid.N; }
+    int value(int row, int col) const { return grid.at(row, col); }
+
+    //Puts value (0 empties the cell) into a cell. Values outside 0..N are
+    //ignored. changed receives the row-major cells whose look changed: the
+    //cell itself and, when a digit starts or stops repeating in a unit, the
+    //other cells of that unit holding it.
+    void set(int row, int col, int value, std::vector<int>* changed = nullptr);
+
+    //The cell's digit appears again in its row, column or box
+    bool conflicts(int row, int col) const;
+    //No unit holds a digit twice: isValidSudoku() on the board, in O(1)
+    bool isValid() const { return repeats == 0; }
+    //Digits the cell could hold given the other cells, whether or not it is filled
+    DigitMask candidates(int row, int col) const;
+
+private:
+    Grid grid;
+    int units = 0;                  //Rows, then columns, then boxes when the shape has them
+    std::vector<uint8_t> counts;    //counts[unit * N + digit - 1]
+    std::vector<DigitMask> used;    //Digits present in each unit
+    int repeats = 0;                //(unit, digit) pairs counted more than once
+
+    int unitCount(int unit, int digit) const { return counts[unit * grid.N + digit - 1]; }
+    //Adds delta to a digit's count in one unit and reports the unit's cells
+    //when the digit starts or stops repeating there
+    void count(int unit, int digit, int delta, std::vector<int>* changed);
+    int unitCell(int unit, int k) const;
+};
+
+#endif // EDIT_MODEL_H
@@ -0,0 +1,288 @@
+#include "generator.h"
+#include "sudoku.h"
+#include <algorithm>
+using namespace std;
+
+bool parseDifficulty(const string& name, Difficulty& difficulty) {
+    if (name == "any")
+        difficulty = DIFFICULTY_ANY;
+    else if (name == "easy")
+        difficulty = DIFFICULTY_EASY;
+    else if (name == "medium")
+        difficulty = DIFFICULTY_MEDIUM;
+    else if (name == "hard")
+        difficulty = DIFFICULTY_HARD;
+    else
+        return false;
+    return true;
+}
+
+const char* difficultyName(Difficulty difficulty) {
+    switch (difficulty) {
+    case DIFFICULTY_ANY: return "any";
+    case DIFFICULTY_EASY: return "easy";
+    case DIFFICULTY_MEDIUM: return "medium";
+    case DIFFICULTY_HARD: return "hard";
+    }
+    return "unknown";
+}
+
+//Random order of 0..n-1 that keeps groups of groupSize together, so rows
+//stay inside their band (groupSize 0 shuffles freely)
+static void groupedPermutation(SplitMix64& rng, int n, int groupSize, vector<int>& map) {
+    map.resize(n);
+    if (groupSize == 0) {
+        for (int i = 0; i < n; i++)
+            map[i] = i;
+        rng.shuffle(map);
+        return;
+    }
+    vector<int> groups(n / groupSize), inside(groupSize);
+    for (int g = 0; g < (int)groups.size(); g++)
+        groups[g] = g;
+    rng.shuffle(groups);
+    for (int g = 0; g < (int)groups.size(); g++) {
+        for (int i = 0; i < groupSize; i++)
+            inside[i] = i;
+        rng.shuffle(inside);
+        for (int i = 0; i < groupSize; i++)
+            map[g * groupSize + i] = groups[g] * groupSize + inside[i];
+    }
+}
+
+void PuzzleGenerator::shuffleBoard(Grid& grid) {
+    int N = grid.N;
+    const BoardGeometry& geometry = grid.geometry;
+    groupedPermutation(rng, N, geometry.boxRows, rowMap);
+    groupedPermutation(rng, N, geometry.boxCols, colMap);
+    digitMap.resize(N + 1);
+    digitMap[0] = 0;
+    for (int d = 1; d <= N; d++)
+        digitMap[d] = d;
+    for (int d = N; d > 1; d--)
+        swap(digitMap[d], digitMap[1 + rng.below(d)]);
+    //Transposing turns R x C boxes into C x R ones, so only square boxes allow it
+    bool transpose = geometry.boxRows == geometry.boxCols && rng.below(2) == 1;
+
+    board.copyFrom(grid);
+    for (int row = 0; row < N; row++) {
+        for (int col = 0; col < N; col++) {
+            uint8_t num = board.at(rowMap[row], colMap[col]);
+            if (transpose)
+                grid.at(col, row) = digitMap[num];
+            else
+                grid.at(row, col) = digitMap[num];
+        }
+    }
+}
+
+//Nodes one draw of the diagonal boxes may take before fillGrid() draws again,
+//and draws that may run out of them before it takes the pattern board
+const uint64_t FILL_NODE_BUDGET = 1 << 14;
+const int FILL_DRAWS = 4;
+
+//Nodes the uniqueness check of one clue removal may take; past it the clue
+//is kept. Boards up to 16x16 almost never need that many, larger ones would
+//otherwise spend minutes proving single removals. The search rate() times
+//gets its own, larger budget: past 25x25 a puzzle left by the removals can
+//take the engine far longer than making it did.
+const uint64_t UNIQUE_NODE_BUDGET = 1 << 10;
+const uint64_t RATE_NODE_BUDGET = 1 << 16;
+
+//Complete board straight from the box shape: row r is the digits shifted by
+//boxCols * (r % boxRows) + r / boxRows, which puts every digit once in each
+//column and box. Without boxes it is the cyclic Latin square.
+static void patternBoard(const BoardGeometry& geometry, Grid& grid) {
+    int N = geometry.N;
+    for (int row = 0; row < N; row++) {
+        int shift = geometry.hasBoxes() ? geometry.boxCols * (row % geometry.boxRows) + row / geometry.boxRows : row;
+        for (int col = 0; col < N; col++)
+            grid.at(row, col) = (uint8_t)((shift + col) % N + 1);
+    }
+}
+
+void PuzzleGenerator::fillGrid(int N, Grid& solution) {
+    fillGrid(BoardGeometry::standard(N), solution);
+}
+
+void PuzzleGenerator::fillGrid(const BoardGeometry& geometry, Grid& solution) {
+    solution.resize(geometry);
+    int N = geometry.N;
+
+    //The boxes on the diagonal (band b, stack b) share no row or column, so
+    //any digits go. Without boxes a random first row does the same.
+    //Small boards can draw boxes that leave no solution; then it draws again.
+    //Large boards sometimes draw a start whose search runs very long, so each
+    //draw gets a node budget and a fresh draw is usually faster than going on.
+    //After FILL_DRAWS such draws (only 49x49 and up get there) the pattern
+    //board stands in; the shuffle below still makes it a random-looking one.
+    vector<int> digits(N);
+    for (int d = 0; d < N; d++)
+        digits[d] = d + 1;
+    int diagonal = geometry.hasBoxes() ? min(geometry.boxRows, geometry.boxCols) : 1;
+    SolveControl budget;
+    budget.nodeLimit = FILL_NODE_BUDGET;
+    bool solved = false;
+    int outOfBudget = 0;
+    while (!solved) {
+        if (outOfBudget == FILL_DRAWS) {
+            patternBoard(geometry, solution);
+            break;
+        }
+        for (int b = 0; b < diagonal; b++) {
+            rng.shuffle(digits);
+            for (int k = 0; k < N; k++) {
+                int cell = geometry.hasBoxes() ? solution.boxCell(b * geometry.boxRows + b, k) : solution.rowCell(0, k);
+                solution.cells[cell] = digits[k];
+            }
+        }
+
+        if (N <= MAX_MASK_DIGITS) {
+            solver.load(solution);
+            solver.solutionLimit = 1;
+            solver.hiddenSingles = true;
+            solver.control = &budget;
+            solved = solver.solve();
+            solver.control = nullptr;
+            if (solved)
+                solver.store(solution);
+            else if (solver.cancelled)
+                outOfBudget++;
+        } else {
+            solved = solveSudoku(solution, 0, 0);
+        }
+    }
+    shuffleBoard(solution);
+}
+
+bool PuzzleGenerator::solvedBySingles(const Grid& puzzle, bool hidden) {
+    solver.load(puzzle);
+    solver.hiddenSingles = hidden;
+    bool solved = solver.propagate() && solver.emptyLeft == 0;
+    solver.hiddenSingles = true;
+    return solved;
+}
+
+bool PuzzleGenerator::stillUnique(const Grid& puzzle, int cell, int num) {
+    if (puzzle.N > MAX_MASK_DIGITS) {
+        board.copyFrom(puzzle);
+        return countSolutions(board, 2) == 1;
+    }
+    //The puzzle had one solution with num in cell, so it is still unique
+    //exactly when no other digit there leads to a solution. A search that
+    //runs out of nodes proves nothing, so the clue stays.
+    SolveControl budget;
+    budget.nodeLimit = UNIQUE_NODE_BUDGET;
+    solver.load(puzzle);
+    solver.solutionLimit = 1;
+    solver.control = &budget;
+    DigitMask others = solver.candidates(cell) & ~(DigitMask(1) << (num - 1));
+    bool unique = others == 0 || (!solver.branch(cell, others) && !solver.cancelled);
+    solver.control = nullptr;
+    return unique;
+}
+
+bool PuzzleGenerator::keepsDifficulty(const Grid& puzzle, int cell, int num, Difficulty difficulty) {
+    if (difficulty == DIFFICULTY_EASY)
+        return solvedBySingles(puzzle, false);
+    if (difficulty == DIFFICULTY_MEDIUM)
+        return solvedBySingles(puzzle, true);
+    return stillUnique(puzzle, cell, num);
+}
+
+PuzzleRating PuzzleGenerator::rate(const Grid& puzzle) {
+    PuzzleRating rating;
+    for (int cell = 0; cell < puzzle.size(); cell++)
+        if (puzzle.cells[cell] != 0)
+            rating.clues++;
+    if (puzzle.N > MAX_MASK_DIGITS)
+        return rating;
+
+    rating.nakedOnly = solvedBySingles(puzzle, false);
+    rating.singlesOnly = rating.nakedOnly || solvedBySingles(puzzle, true);
+    SolveControl budget;
+    budget.nodeLimit = RATE_NODE_BUDGET;
+    solver.load(puzzle);
+    solver.solutionLimit = 1;
+    solver.control = &budget;
+    solver.solve();
+    solver.control = nullptr;
+    rating.guesses = solver.guesses;
+    rating.nodes = solver.nodes;
+    rating.complete = !solver.cancelled;
+
+    if (rating.nakedOnly)
+        rating.difficulty = DIFFICULTY_EASY;
+    else if (rating.singlesOnly)
+        rating.difficulty = DIFFICULTY_MEDIUM;
+    else
+        rating.difficulty = DIFFICULTY_HARD;
+    return rating;
+}
+
+//Each removal was proven with the removed digit known; solving from the clues
+//alone can still be far harder. Every prefix of the removals keeps a superset
+//of the final clues and so stays unique: binary search for the longest prefix
+//rate() finishes within its budget. The empty prefix is the full board.
+PuzzleRating PuzzleGenerator::backOff(Grid& puzzle) {
+    size_t lo = 0, hi = removed.size();
+    PuzzleRating best = rate(full);
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        puzzle.copyFrom(full);
+        for (size_t k = 0; k < mid; k++)
+            puzzle.cells[removed[k]] = 0;
+        PuzzleRating result = rate(puzzle);
+        if (result.complete) {
+            lo = mid;
+            best = result;
+        } else
+            hi = mid;
+    }
+    puzzle.copyFrom(full);
+    for (size_t k = 0; k < lo; k++)
+        puzzle.cells[removed[k]] = 0;
+    return best;
+}
+
+bool PuzzleGenerator::generate(int N, Difficulty difficulty, Grid& puzzle, Grid* solution, PuzzleRating* rating) {
+    return generate(BoardGeometry::standard(N), difficulty, puzzle, solution, rating);
+}
+
+bool PuzzleGenerator::generate(const BoardGeometry& geometry, Difficulty difficulty, Grid& puzzle, Grid* solution,
+                               PuzzleRating* rating) {
+    int N = geometry.N;
+    for (int attempt = 0; attempt < attempts; attempt++) {
+        fillGrid(geometry, puzzle);
+        full.copyFrom(puzzle);
+        if (solution != nullptr)
+            solution->copyFrom(puzzle);
+
+        order.resize(N * N);
+        for (int cell = 0; cell < N * N; cell++)
+            order[cell] = cell;
+        rng.shuffle(order);
+        removed.clear();
+        for (size_t k = 0; k < order.size() && N * N - (int)removed.size() > minClues; k++) {
+            int cell = order[k];
+            uint8_t num = puzzle.cells[cell];
+            puzzle.cells[cell] = 0;
+            if (keepsDifficulty(puzzle, cell, num, difficulty))
+                removed.push_back(cell);
+            else
+                puzzle.cells[cell] = num;
+        }
+
+        PuzzleRating result = rate(puzzle);
+        if (!result.complete)
+            result = backOff(puzzle);
+        //Removal only stops at the ceiling, so check the floor
+        if ((difficulty == DIFFICULTY_MEDIUM && result.nakedOnly)
+            || (difficulty == DIFFICULTY_HARD && result.guesses == 0))
+            continue;
+        if (rating != nullptr)
+            *rating = result;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,104 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "grid.h"
+#include "propagate.h"
+
+//splitmix64: small, fast and the same sequence on every platform for a given
+//seed, unlike the std distributions
+struct SplitMix64 {
+    uint64_t state;
+
+    explicit SplitMix64(uint64_t seed = 0) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    //Uniform in 0..n-1
+    int below(int n) { return (int)(next() % (uint64_t)n); }
+
+    template <class T>
+    void shuffle(std::vector<T>& items) {
+        for (int i = (int)items.size() - 1; i > 0; i--)
+            std::swap(items[i], items[below(i + 1)]);
+    }
+};
+
+//Graded by what the propagation solver needs to finish the puzzle
+enum Difficulty {
+    DIFFICULTY_ANY,     //Any unique puzzle
+    DIFFICULTY_EASY,    //Naked singles alone solve it
+    DIFFICULTY_MEDIUM,  //Needs hidden singles, but no guessing
+    DIFFICULTY_HARD     //Needs at least one guess
+};
+
+//"any", "easy", "medium" or "hard"; returns false for an unknown name
+bool parseDifficulty(const std::string& name, Difficulty& difficulty);
+const char* difficultyName(Difficulty difficulty);
+
+//Solver effort on one puzzle
+struct PuzzleRating {
+    int clues = 0;
+    bool nakedOnly = false;     //Naked singles alone fill the board
+    bool singlesOnly = false;   //Naked and hidden singles fill the board
+    uint64_t guesses = 0;       //Branch digits the propagation search tried
+    uint64_t nodes = 0;         //Its search() calls
+    bool complete = true;       //False when the search ran out of nodes; guesses and nodes are then lower bounds
+    Difficulty difficulty = DIFFICULTY_ANY;
+};
+
+//Makes puzzles with exactly one solution. A random full board comes from
+//random digits in the diagonal boxes, a solve and random symmetry moves
+//(digit relabelling, row and column swaps inside bands and stacks, band and
+//stack swaps, transposition when the boxes are square). Clues are then
+//removed in random order while the puzzle stays within the requested
+//difficulty: for easy and medium that is "still solved by singles", which
+//also proves uniqueness. Otherwise the puzzle was unique with the removed
+//digit in its cell, so it stays unique when one branch search over the
+//cell's other candidates finds no solution within a node budget. If the
+//result is then too hard to rate within budget, the last removals are undone.
+//The same seed gives the same puzzles.
+struct PuzzleGenerator {
+    SplitMix64 rng;
+    PropagationSolver solver;
+    int attempts = 100;             //Full boards tried before generate() gives up
+    int minClues = 0;               //Clue removal stops at this many; keeps 16x16 and up tractable
+
+    explicit PuzzleGenerator(uint64_t seed = 0) : rng(seed) {}
+
+    //Random complete board of size N with the standard boxes, or of the given shape
+    void fillGrid(int N, Grid& solution);
+    void fillGrid(const BoardGeometry& geometry, Grid& solution);
+
+    //Puzzle of the requested difficulty; false when none was found within attempts
+    bool generate(int N, Difficulty difficulty, Grid& puzzle, Grid* solution = nullptr,
+                  PuzzleRating* rating = nullptr);
+    bool generate(const BoardGeometry& geometry, Difficulty difficulty, Grid& puzzle, Grid* solution = nullptr,
+                  PuzzleRating* rating = nullptr);
+
+    //Effort the solver needs on a puzzle with a unique solution, within a node budget
+    PuzzleRating rate(const Grid& puzzle);
+
+private:
+    Grid board, full;
+    std::vector<int> order, removed;
+    std::vector<int> rowMap, colMap, digitMap;
+
+    void shuffleBoard(Grid& grid);
+    //Restores removed clues until rate() finishes within its budget
+    PuzzleRating backOff(Grid& puzzle);
+    //Singles fill the board, with or without hidden singles
+    bool solvedBySingles(const Grid& puzzle, bool hidden);
+    //Whether the puzzle, unique before num was taken out of cell, still is
+    bool stillUnique(const Grid& puzzle, int cell, int num);
+    //Same, and still no harder than asked
+    bool keepsDifficulty(const Grid& puzzle, int cell, int num, Difficulty difficulty);
+};
+
+#endif // GENERATOR_H
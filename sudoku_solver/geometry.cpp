@@ -0,0 +1,22 @@
+#include "geometry.h"
+#include <cstdio>
+
+BoardGeometry BoardGeometry::standard(int N) {
+    int rows = 0;
+    for (int r = 1; r * r <= N; r++)
+        if (N % r == 0)
+            rows = r;
+    //A 1-row box would only repeat the row rule
+    if (rows < 2)
+        return BoardGeometry(N, N == 1 ? 1 : 0, N == 1 ? 1 : 0);
+    return BoardGeometry(N, rows, N / rows);
+}
+
+bool BoardGeometry::parse(const char* text, BoardGeometry& geometry) {
+    int rows, cols;
+    char end;
+    if (sscanf(text, "%dx%d%c", &rows, &cols, &end) != 2 || rows < 2 || cols < 2 || rows * cols > 255)
+        return false;
+    geometry = BoardGeometry(rows * cols, rows, cols);
+    return true;
+}
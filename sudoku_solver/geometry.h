@@ -0,0 +1,41 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+//Box layout of an N x N board. Every box is boxRows x boxCols cells with
+//boxRows * boxCols == N, so the board has boxCols bands of boxRows rows and
+//boxRows stacks of boxCols columns; box b sits in band b / boxRows and stack
+//b % boxRows. A board without boxes has boxRows == boxCols == 0 and only the
+//row and column rules.
+struct BoardGeometry {
+    int N = 0;
+    int boxRows = 0;
+    int boxCols = 0;
+
+    BoardGeometry() {}
+    BoardGeometry(int N, int boxRows, int boxCols) : N(N), boxRows(boxRows), boxCols(boxCols) {}
+
+    //Square boxes when N is a perfect square, otherwise the squarest
+    //rectangle with boxRows < boxCols (2x3 for 6, 2x4 for 8, 3x4 for 12).
+    //N with no such divisor (2, 3 and primes) gets no boxes.
+    static BoardGeometry standard(int N);
+    //"RxC" for R-row by C-column boxes, both at least 2; false otherwise
+    static bool parse(const char* text, BoardGeometry& geometry);
+
+    bool hasBoxes() const { return boxRows != 0; }
+    bool isStandard() const { return *this == standard(N); }
+
+    int boxOf(int row, int col) const { return (row / boxRows) * boxRows + col / boxCols; }
+    //Row-major index of the k-th cell of a box
+    int boxCell(int box, int k) const {
+        return ((box / boxRows) * boxRows + k / boxCols) * N + (box % boxRows) * boxCols + k % boxCols;
+    }
+    //Position of a cell inside its box, 0..N-1
+    int inBox(int row, int col) const { return (row % boxRows) * boxCols + col % boxCols; }
+
+    bool operator==(const BoardGeometry& other) const {
+        return N == other.N && boxRows == other.boxRows && boxCols == other.boxCols;
+    }
+    bool operator!=(const BoardGeometry& other) const { return !(*this == other); }
+};
+
+#endif // GEOMETRY_H
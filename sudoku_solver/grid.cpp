@@ -0,0 +1,32 @@
+#include "grid.h"
+using namespace std;
+
+//Same N keeps the box shape
+void Grid::resize(int n) {
+    resize(n == N ? geometry : BoardGeometry::standard(n));
+}
+
+void Grid::resize(const BoardGeometry& shape) {
+    N = shape.N;
+    geometry = shape;
+    cells.assign(N * N, 0);
+}
+
+void Grid::fromRows(const vector<vector<int>>& rows, int n) {
+    if (n != N) {
+        N = n;
+        geometry = BoardGeometry::standard(N);
+        cells.resize(N * N);
+    }
+    for (int row = 0; row < N; row++)
+        for (int col = 0; col < N; col++)
+            cells[row * N + col] = (uint8_t)rows[row][col];
+}
+
+void Grid::toRows(vector<vector<int>>& rows) const {
+    if ((int)rows.size() != N || (N > 0 && (int)rows[0].size() != N))
+        rows.assign(N, vector<int>(N, 0));
+    for (int row = 0; row < N; row++)
+        for (int col = 0; col < N; col++)
+            rows[row][col] = cells[row * N + col];
+}
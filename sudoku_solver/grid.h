@@ -0,0 +1,100 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+#include "geometry.h"
+
+//Allocator that starts every block on a 64-byte cache line
+template <class T>
+struct CacheLineAllocator {
+    typedef T value_type;
+    static const size_t ALIGNMENT = 64;
+
+    CacheLineAllocator() {}
+    template <class U>
+    CacheLineAllocator(const CacheLineAllocator<U>&) {}
+
+    T* allocate(size_t n) { return (T*)::operator new(n * sizeof(T), std::align_val_t(ALIGNMENT)); }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(ALIGNMENT)); }
+
+    template <class U>
+    bool operator==(const CacheLineAllocator<U>&) const { return true; }
+    template <class U>
+    bool operator!=(const CacheLineAllocator<U>&) const { return false; }
+};
+
+typedef std::vector<uint8_t, CacheLineAllocator<uint8_t>> GridCells;
+
+//Board of N*N cells stored row-major as one byte each in a single buffer.
+//0 is an empty cell. The buffer starts on a cache line, so a 9x9 board (81
+//bytes) spans exactly two, and copying one to start a search is a single memcpy.
+struct Grid {
+    int N = 0;
+    BoardGeometry geometry;         //Box shape, BoardGeometry::standard(N) unless set otherwise
+    GridCells cells;
+
+    Grid() {}
+    explicit Grid(int N) { resize(N); }
+    explicit Grid(const BoardGeometry& geometry) { resize(geometry); }
+    explicit Grid(const std::vector<std::vector<int>>& rows) { fromRows(rows, (int)rows.size()); }
+
+    //Empties the board; the buffer is reused when N does not change, and so is
+    //the box shape, which a new N resets to the standard one
+    void resize(int N);
+    void resize(const BoardGeometry& geometry);
+
+    uint8_t& at(int row, int col) { return cells[row * N + col]; }
+    uint8_t at(int row, int col) const { return cells[row * N + col]; }
+    uint8_t* data() { return cells.data(); }
+    const uint8_t* data() const { return cells.data(); }
+    int size() const { return N * N; }
+
+    //Index of the k-th cell of a row, column or block
+    int rowCell(int row, int k) const { return row * N + k; }
+    int colCell(int col, int k) const { return k * N + col; }
+    int boxCell(int box, int k) const { return geometry.boxCell(box, k); }
+    int boxOf(int row, int col) const { return geometry.boxOf(row, col); }
+
+    void copyFrom(const Grid& other) {
+        if (other.geometry != geometry)
+            resize(other.geometry);
+        memcpy(cells.data(), other.cells.data(), cells.size());
+    }
+
+    //Conversions for the vector<vector<int>> boards of the GUI and the old API.
+    //Values above 255 do not fit in a cell. A new N gets the standard boxes.
+    void fromRows(const std::vector<std::vector<int>>& rows, int N);
+    void toRows(std::vector<std::vector<int>>& rows) const;
+};
+
+//Layout of the common board sizes with the block arithmetic known at compile
+//time, for code specialized on N (switch on grid.N and call the SIZE version
+//when the board has the standard square boxes)
+template <int SIZE>
+struct FixedGrid {
+    static const int N = SIZE;
+    static const int BLOCK = SIZE == 4 ? 2 : SIZE == 9 ? 3 : SIZE == 16 ? 4 : SIZE == 25 ? 5 : 0;
+    static const int CELLS = SIZE * SIZE;
+    static_assert(BLOCK * BLOCK == SIZE, "FixedGrid is only defined for 4, 9, 16 and 25");
+
+    alignas(64) uint8_t cells[CELLS];
+
+    uint8_t& at(int row, int col) { return cells[row * SIZE + col]; }
+    uint8_t at(int row, int col) const { return cells[row * SIZE + col]; }
+
+    static int rowCell(int row, int k) { return row * SIZE + k; }
+    static int colCell(int col, int k) { return k * SIZE + col; }
+    static int boxCell(int box, int k) {
+        return (box / BLOCK) * BLOCK * SIZE + (box % BLOCK) * BLOCK + (k / BLOCK) * SIZE + k % BLOCK;
+    }
+    static int boxOf(int row, int col) { return (row / BLOCK) * BLOCK + col / BLOCK; }
+
+    void load(const Grid& grid) { memcpy(cells, grid.data(), CELLS); }
+    void store(Grid& grid) const { memcpy(grid.data(), cells, CELLS); }
+};
+
+#endif // GRID_H
@@ -0,0 +1,193 @@
+#include "iterative.h"
+#include <cstring>
+using namespace std;
+
+const char CHECKPOINT_MAGIC[4] = { 'S', 'D', 'K', 'C' };
+const uint32_t CHECKPOINT_VERSION = 2;
+
+static void putU32(vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+static uint32_t getU32(const uint8_t* in) {
+    return in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+bool SearchCheckpoint::write(FILE* file) const {
+    vector<uint8_t> out(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + 4);
+    putU32(out, CHECKPOINT_VERSION);
+    putU32(out, geometry.N);
+    putU32(out, geometry.boxRows);
+    putU32(out, geometry.boxCols);
+    putU32(out, startCell);
+    putU32(out, (uint32_t)nodes);
+    putU32(out, (uint32_t)(nodes >> 32));
+    putU32(out, entering);
+    putU32(out, (uint32_t)digits.size());
+    out.insert(out.end(), puzzle.begin(), puzzle.end());
+    out.insert(out.end(), digits.begin(), digits.end());
+    for (size_t k = 0; k < untried.size(); k++) {
+        putU32(out, (uint32_t)untried[k]);
+        putU32(out, (uint32_t)(untried[k] >> 32));
+    }
+    return fwrite(out.data(), 1, out.size(), file) == out.size();
+}
+
+bool SearchCheckpoint::read(FILE* file) {
+    uint8_t header[40];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)
+        || memcmp(header, CHECKPOINT_MAGIC, 4) != 0 || getU32(header + 4) != CHECKPOINT_VERSION)
+        return false;
+    int N = (int)getU32(header + 8);
+    geometry = BoardGeometry(N, (int)getU32(header + 12), (int)getU32(header + 16));
+    startCell = getU32(header + 20);
+    nodes = getU32(header + 24) | (uint64_t)getU32(header + 28) << 32;
+    entering = getU32(header + 32) != 0;
+    uint32_t frames = getU32(header + 36);
+    if (N <= 0 || N > MAX_MASK_DIGITS || frames > (uint32_t)(N * N)
+        || geometry.boxRows < 0 || geometry.boxCols < 0 || geometry.boxRows * geometry.boxCols != (geometry.hasBoxes() ? N : 0))
+        return false;
+
+    puzzle.resize(N * N);
+    digits.resize(frames);
+    untried.resize(frames);
+    vector<uint8_t> masks(frames * 8);
+    if (fread(puzzle.data(), 1, puzzle.size(), file) != puzzle.size()
+        || fread(digits.data(), 1, digits.size(), file) != digits.size()
+        || fread(masks.data(), 1, masks.size(), file) != masks.size())
+        return false;
+    for (uint32_t k = 0; k < frames; k++)
+        untried[k] = getU32(&masks[k * 8]) | (DigitMask)getU32(&masks[k * 8 + 4]) << 32;
+    return true;
+}
+
+void IterativeSolver::load(const Grid& grid, int startCell) {
+    BitboardSolver::load(grid, startCell);
+    reset(startCell);
+}
+
+void IterativeSolver::loadCells(const uint8_t* flat, const BoardGeometry& shape, int startCell) {
+    BitboardSolver::loadCells(flat, shape, startCell);
+    reset(startCell);
+}
+
+void IterativeSolver::reset(int start) {
+    startCell = start;
+    frames.resize(empties.size());
+    depth = 0;
+    entering = true;
+    state = SEARCH_RUNNING;
+}
+
+IterativeSolver::State IterativeSolver::run(uint64_t budget) {
+    if (state != SEARCH_RUNNING)
+        return state;
+    uint64_t stopAt = budget ? nodes + budget : ~uint64_t(0);
+
+    //The loop works on locals and stores them back whenever it returns
+    Frame* stack = frames.data();
+    const size_t goal = empties.size();
+    size_t top = depth;
+    bool enter = entering;
+    while (true) {
+        if (enter) {
+            //One node, the same as a search(top) call
+            if (nodes >= stopAt) {
+                state = SEARCH_RUNNING;
+                break;
+            }
+            nodes++;
+            if (pollControl(control, nodes, (int)top)) {
+                cancelled = true;
+                state = SEARCH_CANCELLED;
+                break;
+            }
+            if (top == goal) {
+                state = SEARCH_SOLVED;
+                break;
+            }
+            SOLVE_DEPTH(stats, top + 1);
+            Frame& frame = stack[top];
+            frame.cell = empties[top];
+            frame.untried = candidates(frame.cell);
+            top++;
+            enter = false;
+        } else {
+            //Back at the top frame: undo the digit that failed
+            Frame& frame = stack[top - 1];
+            remove(frame.cell, cells[frame.cell]);
+            SOLVE_COUNT(stats, backtracks);
+            SOLVE_TRACE(trace, undo(nodes, (int)top - 1));
+        }
+
+        //Next digit of the top frame, or pop it when none is left
+        Frame& frame = stack[top - 1];
+        if (frame.untried == 0) {
+            if (--top == 0) {
+                state = SEARCH_EXHAUSTED;
+                break;
+            }
+            continue;
+        }
+        int num = lowestDigit(frame.untried);
+        frame.untried &= frame.untried - 1;
+        SOLVE_COUNT(stats, guesses);
+        SOLVE_TRACE(trace, branch(nodes, frame.cell, num, (int)top - 1));
+        place(frame.cell, num);
+        enter = true;
+    }
+    depth = top;
+    entering = enter;
+    return state;
+}
+
+void IterativeSolver::saveCheckpoint(SearchCheckpoint& checkpoint) const {
+    checkpoint.geometry = geometry;
+    checkpoint.startCell = startCell;
+    checkpoint.nodes = nodes;
+    checkpoint.entering = entering;
+    checkpoint.puzzle = cells;
+    for (size_t k = 0; k < empties.size(); k++)
+        checkpoint.puzzle[empties[k]] = 0;
+    checkpoint.digits.resize(depth);
+    checkpoint.untried.resize(depth);
+    for (size_t k = 0; k < depth; k++) {
+        checkpoint.digits[k] = cells[frames[k].cell];
+        checkpoint.untried[k] = frames[k].untried;
+    }
+}
+
+bool IterativeSolver::restoreCheckpoint(const SearchCheckpoint& checkpoint) {
+    int n = checkpoint.geometry.N;
+    if ((int)checkpoint.puzzle.size() != n * n || checkpoint.digits.size() != checkpoint.untried.size())
+        return false;
+    //A given above N would never clash, so the search could "solve" a bad board
+    for (int i = 0; i < n * n; i++)
+        if (checkpoint.puzzle[i] > n)
+            return false;
+    loadCells(checkpoint.puzzle.data(), checkpoint.geometry, checkpoint.startCell);
+    size_t frameCount = checkpoint.digits.size();
+    //run() leaves every frame with a digit placed, and an empty stack only before the first node
+    if (frameCount > empties.size() || (frameCount == 0 && !checkpoint.entering))
+        return false;
+    for (size_t k = 0; k < frameCount; k++) {
+        int cell = empties[k];
+        int num = checkpoint.digits[k];
+        if (num < 1 || num > N)
+            return false;
+        //The digit and the ones left to try all come from the cell's candidates
+        //under the frames below it, and the untried ones are above the digit
+        DigitMask digit = DigitMask(1) << (num - 1);
+        DigitMask allowed = candidates(cell);
+        if (!(allowed & digit) || (checkpoint.untried[k] & ~(allowed & ~(digit | (digit - 1)))))
+            return false;
+        frames[k].cell = cell;
+        frames[k].untried = checkpoint.untried[k];
+        place(cell, num);
+    }
+    depth = frameCount;
+    entering = checkpoint.entering;
+    nodes = checkpoint.nodes;
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef ITERATIVE_H
+#define ITERATIVE_H
+
+#include <cstdio>
+#include "bitboard.h"
+
+//Everything needed to carry on a suspended IterativeSolver search, possibly
+//in another process: the board it was loaded with and the stack of frames
+struct SearchCheckpoint {
+    BoardGeometry geometry;
+    int startCell = 0;
+    uint64_t nodes = 0;
+    bool entering = false;
+    std::vector<uint8_t> puzzle;        //Board as loaded, N*N cells
+    std::vector<uint8_t> digits;        //Digit placed by every frame on the stack
+    std::vector<DigitMask> untried;
+
+    //Little-endian binary form; read() returns false on a short or foreign file
+    bool write(FILE* file) const;
+    bool read(FILE* file);
+};
+
+//Same search as BitboardSolver::search() (the empty cells in row-major order,
+//digits in increasing order) with the recursion replaced by a preallocated
+//stack of frames, one per empty cell. run() can stop after any number of
+//nodes and the next call carries on from the same place, so a long solve can
+//be time-sliced in an event loop or checkpointed.
+struct IterativeSolver : BitboardSolver {
+    enum State { SEARCH_RUNNING, SEARCH_SOLVED, SEARCH_EXHAUSTED, SEARCH_CANCELLED };
+
+    struct Frame {
+        int cell;
+        DigitMask untried;      //Candidates of cell not tried yet
+    };
+
+    std::vector<Frame> frames;  //frames[k] is empties[k]; sized once per load()
+    size_t depth = 0;           //Frames in use
+    bool entering = true;       //The next step visits a node below the top frame
+    State state = SEARCH_EXHAUSTED;
+
+    void load(const Grid& grid, int startCell = 0);
+    void loadCells(const uint8_t* flat, const BoardGeometry& geometry, int startCell = 0);
+
+    //Visits up to budget more nodes (0 for no limit) and returns the state.
+    //SEARCH_RUNNING means the budget ran out and run() can be called again.
+    State run(uint64_t budget = 0);
+    bool solve() { return run() == SEARCH_SOLVED; }
+
+    void saveCheckpoint(SearchCheckpoint& checkpoint) const;
+    //Reloads the checkpoint's board and replays its frames; false if they do not fit it
+    bool restoreCheckpoint(const SearchCheckpoint& checkpoint);
+
+private:
+    int startCell = 0;
+    void reset(int startCell);
+};
+
+#endif // ITERATIVE_H
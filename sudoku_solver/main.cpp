@@ -6,139 +6,45 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include "sudoku.h"
+#include "edit_model.h"
+#include "puzzle_io.h"
+#include "render_cache.h"
 using namespace std;
 
-bool isSafe(const vector<vector<int>>& grid, int N, int row, int col, int num) {
-    //Check in Row
-    for (int x = 0; x < N; x++)
-        if (grid[row][x] == num)
-            return false;
-
-    //Check in Coloumn
-    for (int x = 0; x < N; x++)
-        if (grid[x][col] == num)
-            return false;
-
-    //Block check (generalized for square blocks if N is a perfect square)
-    if (sqrt(N) == floor(sqrt(N))) {
-        int blockSize = sqrt(N);
-        int startRow = row - row % blockSize;
-        int startCol = col - col % blockSize;
-        for (int i = 0; i < blockSize; i++)
-            for (int j = 0; j < blockSize; j++)
-                if (grid[i + startRow][j + startCol] == num)
-                    return false;
-    } else if (N == 9) { //Special case for 9x9 to keep 3x3 blocks
-        int startRow = row - row % 3;
-        int startCol = col - col % 3;
-        for (int i = 0; i < 3; i++)
-            for (int j = 0; j < 3; j++)
-                if (grid[i + startRow][j + startCol] == num)
-                    return false;
-    }
-
-    return true;
-}
-
-bool solveSudoku(vector<vector<int>>& grid, int N, int row, int col) {
-    if (row == N - 1 && col == N)
-        return true;
-
-    if (col == N) {
-        row++;
-        col = 0;
-    }
-
-    if (grid[row][col] > 0)
-        return solveSudoku(grid, N, row, col + 1);
-
-    for (int num = 1; num <= N; num++) {
-        if (isSafe(grid, N, row, col, num)) {
-            grid[row][col] = num;
-            if (solveSudoku(grid, N, row, col + 1))
-                return true;
-        }
-        grid[row][col] = 0;
-    }
-    return false;
-}
 
-bool isValidSudoku(const vector<vector<int>>& grid, int N) {
-    for (int row = 0; row < N; row++) {
-        vector<int> row_values;
-        for (int col = 0; col < N; col++) {
-            if (grid[row][col] != 0) {
-                for (int val : row_values) {
-                    if (val == grid[row][col]) return false; // Duplicate in row
-                }
-                row_values.push_back(grid[row][col]);
-            }
-        }
-    }
+int main() {
+    SDL_SetMainReady(); //Needed for SDL_MAIN_HANDLED
 
-    for (int col = 0; col < N; col++) {
-        vector<int> col_values;
-        for (int row = 0; row < N; row++) {
-            if (grid[row][col] != 0) {
-                for (int val : col_values) {
-                    if (val == grid[row][col]) return false; // Duplicate in column
-                }
-                col_values.push_back(grid[row][col]);
-            }
+    //A size gets the standard boxes, a box shape such as 3x4 gives a 12x12 board of 3-row boxes
+    BoardGeometry geometry;
+    while (geometry.N <= 0) {
+        cout << "Enter Sudoku grid size (e.g., 4, 9, 16, ...) or box shape (e.g., 2x3, 3x4): ";
+        string answer;
+        if (!(cin >> answer)) {
+            return 1;
         }
-    }
-
-    if (sqrt(N) == floor(sqrt(N))) {
-        int blockSize = sqrt(N);
-        for (int block_start_row = 0; block_start_row < N; block_start_row += blockSize) {
-            for (int block_start_col = 0; block_start_col < N; block_start_col += blockSize) {
-                vector<int> block_values;
-                for (int row = 0; row < blockSize; row++) {
-                    for (int col = 0; col < blockSize; col++) {
-                        int current_val = grid[block_start_row + row][block_start_col + col];
-                        if (current_val != 0) {
-                            for (int val : block_values) {
-                                if (val == current_val) return false; // Duplicate in block
-                            }
-                            block_values.push_back(current_val);
-                        }
-                    }
-                }
-            }
+        if (!BoardGeometry::parse(answer.c_str(), geometry)) {
+            geometry = BoardGeometry::standard(atoi(answer.c_str()));
         }
-    } else if (N == 9) { // 3x3 block check for 9x9
-        for (int block_start_row = 0; block_start_row < N; block_start_row += 3) {
-            for (int block_start_col = 0; block_start_col < N; block_start_col += 3) {
-                vector<int> block_values;
-                for (int row = 0; row < 3; row++) {
-                    for (int col = 0; col < 3; col++) {
-                        int current_val = grid[block_start_row + row][block_start_col + col];
-                        if (current_val != 0) {
-                            for (int val : block_values) {
-                                if (val == current_val) return false; // Duplicate in 3x3 block
-                            }
-                            block_values.push_back(current_val);
-                        }
-                    }
-                }
-            }
+        if (geometry.N <= 0 || geometry.N > MAX_PUZZLE_DIGITS) {
+            cout << "Grid size must be between 1 and " << MAX_PUZZLE_DIGITS << ". Please try again." << endl;
+            geometry = BoardGeometry();
         }
     }
-    return true; // No immediate violations found
-}
-
+    int N = geometry.N;
 
-int main() {
-    SDL_SetMainReady(); //Needed for SDL_MAIN_HANDLED
-
-    int N = 0;
-    while (N <= 0) {
-        cout << "Enter Sudoku grid size (e.g., 4, 9, 16, ...): ";
-        cin >> N;
-        if (N <= 0) {
-            cout << "Grid size must be a positive integer. Please try again." << endl;
-        }
+    //Solver engine, overridable for A/B runs: SUDOKU_ENGINE=backtrack|propagate|dlx
+    SolveMode solveMode = SOLVE_PROPAGATE;
+    const char* engineName = getenv("SUDOKU_ENGINE");
+    if (engineName != nullptr && !parseSolveMode(engineName, solveMode)) {
+        cout << "Unknown SUDOKU_ENGINE \"" << engineName << "\", using " << solveModeName(solveMode) << "." << endl;
     }
 
 
@@ -146,8 +52,14 @@ int main() {
     int screenWidth = 1000;
     int screenHeight = 800; // Increased height to accommodate messages better
 
-    //To store suduko data - using vector of vectors now
-    vector<vector<int>> arr(N, vector<int>(N, 0)); // Initialize N x N vector with 0s
+    //Cells shrink so large boards stay between the title and the buttons
+    int gridSpace = 520;
+    int cellSize = min(50, gridSpace / N);
+
+    //To store suduko data, with the digit counts of every row, column and box kept
+    //up to date on each edit so conflicts and candidates never need a rescan
+    EditModel board(geometry);
+    vector<int> changedCells; // Row-major cells an edit changed the look of
 
     //mouse coordinates
     int mx;
@@ -157,13 +69,9 @@ int main() {
     int mlp = 0;
 
 
-    //To check if the number is entered or not
-    int gotnum = 0;
-    int numk = 0;   //Number entered from keyboard
-
-    //coordinates of the chosen box
-    int stpx = 0;
-    int stpy = 0;
+    //Digits typed into the selected cell add up to one number (1 then 2 is 12 on
+    //boards of 12 and up); letters enter 10 and up as in puzzle files
+    int typing = 0;
 
     //Coordinate of the text display box (not really used in SDL2 as in RayGui)
     int codrx = 0;
@@ -175,6 +83,18 @@ int main() {
     int enterQuestion = 0;
     int done = 0;
     int clear = 0;
+    int invalidInput = 0;
+    int unsolvable = 0;
+    int cancelled = 0;
+
+    //Background solve: the worker gets its own copy of the board and the
+    //render loop only reads the progress atomics until it has finished
+    int solving = 0;
+    SolveControl solveControl;
+    Grid solverGrid(geometry);
+    bool solverResult = false;
+    atomic<bool> solverFinished(false);
+    thread solverThread;
 
 
     SDL_Window* window = nullptr;
@@ -192,7 +112,7 @@ int main() {
         return 1;
     }
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
     if (renderer == nullptr) {
         SDL_Log("SDL_CreateRenderer Error: %s", SDL_GetError());
         SDL_DestroyWindow(window);
@@ -200,6 +120,8 @@ int main() {
         return 1;
     }
 
+    SDL_StartTextInput(); // Typed characters arrive as SDL_TEXTINPUT, with shift applied
+
     // Initialize SDL_TTF
     if (TTF_Init() == -1) {
         SDL_Log("SDL_TTF Error: %s", TTF_GetError());
@@ -219,15 +141,39 @@ int main() {
         return 1;
     }
 
+    // Small cells get their own, smaller font for the numbers
+    int cellFontSize = max(6, min(20, cellSize * 3 / 5));
+    TTF_Font* cellFont = cellFontSize == 20 ? font : TTF_OpenFont("fonts/arial.ttf", cellFontSize);
+    if (cellFont == nullptr) {
+        cellFont = font;
+    }
+
+    // Text is uploaded once: glyphs for numbers and progress, textures for fixed labels
+    GlyphAtlas glyphAtlas;
+    GlyphAtlas cellGlyphs;
+    LabelCache labelCache;
+    if (!glyphAtlas.build(renderer, font) || !cellGlyphs.build(renderer, cellFont)) {
+        SDL_Log("Glyph atlas Error: %s", SDL_GetError());
+        if (cellFont != font) {
+            TTF_CloseFont(cellFont);
+        }
+        TTF_CloseFont(font);
+        TTF_Quit();
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+
 
     SDL_Event event;
     bool quit = false;
 
     //Starting of suduko table
-    int recx = (screenWidth - N * 50) / 2; // Center the grid horizontally
+    int recx = (screenWidth - N * cellSize) / 2; // Center the grid horizontally
     int recy = 150;
-    int rech = 50; // Increased cell height
-    int recw = 50; // Increased cell width
+    int rech = cellSize;
+    int recw = cellSize;
 
     //coordinates of selected box
     int codx = 0;
@@ -247,6 +193,7 @@ int main() {
     SDL_Color titleColor = {0, 0, 128, 255};              // Navy blue title
     SDL_Color messageColor = {80, 80, 80, 255};            // Darker gray message text
     SDL_Color errorColor = {255, 0, 0, 255};              // Red error message
+    SDL_Color conflictCellColor = {255, 215, 215, 255};   // Light red behind clashing digits
 
     int buttonWidth = 140; // Adjusted button width
     int buttonHeight = 45; // Adjusted button height
@@ -263,66 +210,218 @@ int main() {
     SDL_Rect doneButtonRect =         { startButtonsX + buttonWidth + buttonSpacing, buttonsYPosition, buttonWidth, buttonHeight };
     SDL_Rect clearButtonRect =        { startButtonsX + 2 * buttonWidth + 2 * buttonSpacing, buttonsYPosition, buttonWidth, buttonHeight };
     SDL_Rect generateAnswerButtonRect = { (screenWidth - 300) / 2, buttonsYPosition + buttonHeight + buttonSpacing, 300, buttonHeight }; // Wider Generate Answer button, below others
+    SDL_Rect messageAreaRect = { 0, 95, screenWidth, 50 }; // Everything a status message can cover
+
+
+    // Event driven rendering: the frame is kept in frameTexture and only what changed
+    // is redrawn into it. The grid and block lines are drawn once into gridTexture.
+    SDL_Texture* frameTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, screenWidth, screenHeight);
+    SDL_Texture* gridTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, N * recw + 1, N * rech + 1);
+    int fullRedraw = 1;
+    int messageDirty = 0;
+    int presentAgain = 0;
+    vector<SDL_Point> dirtyCells; // x = column, y = row
+
+    auto drawGridLines = [&](int originX, int originY) {
+        SDL_SetRenderDrawColor(renderer, gridLineColor.r, gridLineColor.g, gridLineColor.b, gridLineColor.a);
+        for (int i = 0; i <= N; ++i) { // Use N here
+            SDL_RenderDrawLine(renderer, originX + i * recw, originY, originX + i * recw, originY + N * rech); // Vertical lines
+            SDL_RenderDrawLine(renderer, originX, originY + i * rech, originX + N * recw, originY + i * rech); // Horizontal lines
+        }
+
+        // Draw thicker block lines
+        SDL_SetRenderDrawColor(renderer, blockLineColor.r, blockLineColor.g, blockLineColor.b, blockLineColor.a);
+        for (int i = 1; geometry.hasBoxes() && i < geometry.boxRows; ++i) { // Stacks are boxCols wide
+            SDL_RenderDrawLine(renderer, originX + i * geometry.boxCols * recw, originY, originX + i * geometry.boxCols * recw, originY + N * rech);
+        }
+        for (int i = 1; geometry.hasBoxes() && i < geometry.boxCols; ++i) { // Bands are boxRows high
+            SDL_RenderDrawLine(renderer, originX, originY + i * geometry.boxRows * rech, originX + N * recw, originY + i * geometry.boxRows * rech);
+        }
+    };
+
+    // Also called again when the renderer loses its target textures (a Direct3D device reset)
+    auto drawGridTexture = [&]() {
+        if (gridTexture != nullptr) {
+            SDL_SetRenderTarget(renderer, gridTexture);
+            SDL_SetRenderDrawColor(renderer, backgroundColor.r, backgroundColor.g, backgroundColor.b, backgroundColor.a);
+            SDL_RenderClear(renderer);
+            drawGridLines(0, 0);
+            SDL_SetRenderTarget(renderer, nullptr);
+        }
+    };
+    drawGridTexture();
+
+    // One cell: grid lines from the cached texture, its number and the selection highlight
+    auto drawCell = [&](int col, int row) {
+        SDL_Rect cellRect = { recx + col * recw, recy + row * rech, recw, rech };
+        if (gridTexture != nullptr) {
+            SDL_Rect source = { col * recw, row * rech, recw + 1, rech + 1 };
+            SDL_Rect target = { cellRect.x, cellRect.y, recw + 1, rech + 1 };
+            SDL_RenderCopy(renderer, gridTexture, &source, &target);
+        }
+        if (board.value(row, col) != 0) {
+            bool conflict = board.conflicts(row, col);
+            if (conflict) { // Inset so the grid lines stay visible
+                SDL_Rect fillRect = { cellRect.x + 1, cellRect.y + 1, recw - 1, rech - 1 };
+                SDL_SetRenderDrawColor(renderer, conflictCellColor.r, conflictCellColor.g, conflictCellColor.b, conflictCellColor.a);
+                SDL_RenderFillRect(renderer, &fillRect);
+            }
+            char numStr[2] = { PUZZLE_ALPHABET[board.value(row, col) - 1], '\0' }; // 1-9, then A for 10 as in puzzle files
+            cellGlyphs.drawCentered(renderer, numStr, cellRect, conflict ? errorColor : textColor); // Center number in cell
+        }
+        if (dxy == 1 && enterQuestion == 1 && codx - 1 == col && cody - 1 == row) {
+            SDL_SetRenderDrawColor(renderer, selectedCellColor.r, selectedCellColor.g, selectedCellColor.b, selectedCellColor.a);
+            SDL_RenderFillRect(renderer, &cellRect);
+        }
+    };
+
+    auto drawMessage = [&]() {
+        SDL_SetRenderDrawColor(renderer, backgroundColor.r, backgroundColor.g, backgroundColor.b, backgroundColor.a);
+        SDL_RenderFillRect(renderer, &messageAreaRect);
+
+        SDL_Rect messageRect = { (screenWidth - 600) / 2, 100, 600, 30 }; // Centered message area below title, adjusted position
+        if (enterQuestion == 1 && dxy == 1) {
+            // Digits the selected cell can still take; spaces only while they fit
+            char hint[160];
+            DigitMask left = board.candidates(cody - 1, codx - 1);
+            int length = snprintf(hint, sizeof(hint), "%s", left != 0 ? "Candidates:" : "No candidates for this cell");
+            for (int d = 1; d <= N; ++d) {
+                if (left & (DigitMask(1) << (d - 1))) {
+                    if (N <= 25) {
+                        hint[length++] = ' ';
+                    }
+                    hint[length++] = PUZZLE_ALPHABET[d - 1];
+                }
+            }
+            hint[length] = '\0';
+            glyphAtlas.draw(renderer, hint, (screenWidth - glyphAtlas.textWidth(hint)) / 2, messageRect.y, left != 0 ? messageColor : errorColor);
+        } else if (enterQuestion == 1 && !board.isValid()) {
+            labelCache.draw(renderer, font, "Digits in red break a rule.", errorColor, messageRect, false);
+        } else if (enterQuestion == 1) {
+            labelCache.draw(renderer, font, "Enter your Sudoku question in the table.", messageColor, messageRect, false);
+        } else if (solving == 1) {
+            char progress[96];
+            snprintf(progress, sizeof(progress), "Generating Answer... %llu nodes, depth %d",
+                     (unsigned long long)solveControl.nodes.load(), solveControl.depth.load());
+            glyphAtlas.draw(renderer, progress, (screenWidth - glyphAtlas.textWidth(progress)) / 2, messageRect.y, messageColor);
+        } else if (generateAnswer == 1 && invalidInput == 1) {
+            labelCache.draw(renderer, font, "Invalid Sudoku Input!", errorColor, messageRect, false);
+        } else if (unsolvable == 1 || cancelled == 1) {
+            labelCache.draw(renderer, font, unsolvable == 1 ? "Sudoku Unsolvable" : "Solving Cancelled", messageColor, messageRect, false);
+        } else if (generateAnswer == 1 && generated == 1) {
+            labelCache.draw(renderer, font, "Answer Generated!", messageColor, messageRect, false);
+        }
+    };
 
 
     while (!quit) {
-        while (SDL_PollEvent(&event)) {
+        // Sleep until something happens; while solving, wake up to refresh the progress
+        for (int gotEvent = SDL_WaitEventTimeout(&event, solving == 1 ? 33 : 1000); gotEvent; gotEvent = SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
                 quit = true;
             }
+            if (event.type == SDL_WINDOWEVENT) {
+                presentAgain = 1;
+            }
+            if (event.type == SDL_RENDER_DEVICE_RESET) { // Every texture was lost, not only what the targets held
+                if (frameTexture != nullptr) {
+                    SDL_DestroyTexture(frameTexture);
+                }
+                if (gridTexture != nullptr) {
+                    SDL_DestroyTexture(gridTexture);
+                }
+                frameTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, screenWidth, screenHeight);
+                gridTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, N * recw + 1, N * rech + 1);
+                labelCache.clear();
+                glyphAtlas.build(renderer, font);
+                cellGlyphs.build(renderer, cellFont);
+            }
+            if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+                drawGridTexture(); // The grid lines are only drawn here, so put them back before the full redraw
+                fullRedraw = 1;
+            }
             if (event.type == SDL_MOUSEBUTTONDOWN) {
                 if (event.button.button == SDL_BUTTON_LEFT) {
                     mx = event.button.x;
                     my = event.button.y;
                     mlp = 1;
 
+                    // While the solver runs only the Cancel button (drawn over Generate Answer) reacts
+                    if (solving == 1) {
+                        if (mx > generateAnswerButtonRect.x && mx < (generateAnswerButtonRect.x + generateAnswerButtonRect.w) &&
+                            my > generateAnswerButtonRect.y && my < (generateAnswerButtonRect.y + generateAnswerButtonRect.h)) {
+                            solveControl.cancel.store(true);
+                        }
+                        continue;
+                    }
+
                     // Button clicks detection:
                     if (mx > enterQuestionButtonRect.x && mx < (enterQuestionButtonRect.x + enterQuestionButtonRect.w) &&
                         my > enterQuestionButtonRect.y && my < (enterQuestionButtonRect.y + enterQuestionButtonRect.h)) {
                         enterQuestion = 1;
                         generateAnswer = 0;
                         generated = 0;
+                        invalidInput = 0; unsolvable = 0; cancelled = 0;
+                        fullRedraw = 1;
                     }
                     if (mx > generateAnswerButtonRect.x && mx < (generateAnswerButtonRect.x + generateAnswerButtonRect.w) &&
                         my > generateAnswerButtonRect.y && my < (generateAnswerButtonRect.y + generateAnswerButtonRect.h)) {
                         generateAnswer = 1;
                         done = 1;
                         enterQuestion = 0;
+                        unsolvable = 0; cancelled = 0;
+                        fullRedraw = 1;
+                        invalidInput = (generated != 1 && !board.isValid()) ? 1 : 0; // Kept current by every edit
+                        if (generated != 1 && invalidInput == 0) {
+                            solverGrid.copyFrom(board.board());
+                            solveControl.reset();
+                            solverFinished.store(false);
+                            solving = 1;
+                            solverThread = thread([&]() {
+                                solverResult = solveSudokuWith(solverGrid, solveMode, &solveControl);
+                                solverFinished.store(true);
+                                SDL_Event wake = {};
+                                wake.type = SDL_USEREVENT;
+                                SDL_PushEvent(&wake); // Wake the render loop
+                            });
+                        }
                     }
                     if (mx > doneButtonRect.x && mx < (doneButtonRect.x + doneButtonRect.w) &&
                         my > doneButtonRect.y && my < (doneButtonRect.y + doneButtonRect.h)) {
                         done = 1;
                         enterQuestion = 0;
+                        fullRedraw = 1;
                     }
                     if (mx > clearButtonRect.x && mx < (clearButtonRect.x + clearButtonRect.w) &&
                         my > clearButtonRect.y && my < (clearButtonRect.y + clearButtonRect.h)) {
                         clear = 1;
                         generateAnswer = 0;
-                        for (int i = 0; i < N; ++i) { // Use N here
-                            for (int j = 0; j < N; ++j) { // Use N here
-                                arr[i][j] = 0;
-                            }
-                        }
+                        board.clear();
                         enterQuestion = 0;
                         generated = 0;
+                        invalidInput = 0; unsolvable = 0; cancelled = 0;
+                        fullRedraw = 1;
                     }
 
                     // Grid cell click detection
                     if (enterQuestion == 1) {
+                        if (dxy == 1) {
+                            dirtyCells.push_back(SDL_Point{ codx - 1, cody - 1 }); // Old selection
+                        }
                         if (mx > recx && mx < (recx + N * recw) && my > recy && my < (recy + N * rech)) { // Use N here
                             codx = ((mx - recx) / recw) + 1;
                             cody = ((my - recy) / rech) + 1;
-                            stpx = recx + (codx - 1) * recw;
-                            stpy = recy + (cody - 1) * rech;
                             codrx = codx;
                             codry = cody;
                             dxy = 1;
+                            typing = 0;
+                            dirtyCells.push_back(SDL_Point{ codx - 1, cody - 1 });
                         } else {
                             dxy = 0;
                             codx = 0;
                             cody = 0;
-                            stpx = 0; stpy = 0;
                         }
+                        messageDirty = 1; // Candidates follow the selection
                     }
                 }
             }
@@ -332,202 +431,149 @@ int main() {
                 }
             }
             if (event.type == SDL_KEYDOWN) {
-                if (codx > 0 && cody > 0 && enterQuestion == 1) {
-                    switch (event.key.keysym.sym) {
-                    case SDLK_1: numk = 1; gotnum = 1; break;
-                    case SDLK_2: numk = 2; gotnum = 1; break;
-                    case SDLK_3: numk = 3; gotnum = 1; break;
-                    case SDLK_4: numk = 4; gotnum = 1; break;
-                    case SDLK_5: numk = 5; gotnum = 1; break;
-                    case SDLK_6: numk = 6; gotnum = 1; break;
-                    case SDLK_7: numk = 7; gotnum = 1; break;
-                    case SDLK_8: numk = 8; gotnum = 1; break;
-                    case SDLK_9: numk = 9; gotnum = 1; break;
-                    case SDLK_BACKSPACE: numk = 0; gotnum = 1; break; // Backspace clears cell
+                if (codx > 0 && cody > 0 && enterQuestion == 1 && event.key.keysym.sym == SDLK_BACKSPACE) { // Backspace clears cell
+                    board.set(cody - 1, codx - 1, 0, &changedCells);
+                    typing = 0;
+                }
+            }
+            if (event.type == SDL_TEXTINPUT) {
+                for (const char* c = event.text.text; *c != '\0' && codx > 0 && cody > 0 && enterQuestion == 1; ++c) {
+                    int cell = board.value(cody - 1, codx - 1);
+                    int numk = -1;
+                    if (*c >= '0' && *c <= '9') {
+                        numk = typing == 1 ? cell * 10 + (*c - '0') : *c - '0';
+                        if (numk > N) {
+                            numk = *c - '0'; // Too large to go on: the digit starts a new number
+                        }
+                    } else if (cellValue(*c, N) >= 10) {
+                        numk = cellValue(*c, N);
                     }
-                    if (gotnum == 1 && numk <= N) { // Ensure entered number is within 1 to N range
-                        arr[codx - 1][cody - 1] = numk;
-                        gotnum = 0;
+                    if (numk >= 1 && numk <= N) { // Ensure entered number is within 1 to N range
+                        board.set(cody - 1, codx - 1, numk, &changedCells);
+                        typing = *c >= '0' && *c <= '9' ? 1 : 0;
                     }
                 }
             }
-        }
-
-        SDL_SetRenderDrawColor(renderer, backgroundColor.r, backgroundColor.g, backgroundColor.b, backgroundColor.a);
-        SDL_RenderClear(renderer);
-
-        // SUDOKU SOLVER Title
-        SDL_Surface* titleSurface = TTF_RenderText_Solid(font, "SUDOKU SOLVER BY MANISH SHRESTHA", titleColor);
-        SDL_Texture* titleTexture = SDL_CreateTextureFromSurface(renderer, titleSurface);
-        SDL_Rect titleRect;
-        titleRect.x = (screenWidth - titleSurface->w) / 2; // Center title
-        titleRect.y = 40; // Adjusted title position
-        SDL_QueryTexture(titleTexture, nullptr, nullptr, &titleRect.w, &titleRect.h);
-        SDL_RenderCopy(renderer, titleTexture, nullptr, &titleRect);
-        SDL_DestroyTexture(titleTexture);
-        SDL_FreeSurface(titleSurface);
-
-
-        // Draw Sudoku Grid
-        SDL_SetRenderDrawColor(renderer, gridLineColor.r, gridLineColor.g, gridLineColor.b, gridLineColor.a);
-        for (int i = 0; i <= N; ++i) { // Use N here
-            SDL_RenderDrawLine(renderer, recx + i * recw, recy, recx + i * recw, recy + N * rech); // Vertical lines
-            SDL_RenderDrawLine(renderer, recx, recy + i * rech, recx + N * recw, recy + i * rech); // Horizontal lines
-        }
-
-        // Draw thicker block lines
-        SDL_SetRenderDrawColor(renderer, blockLineColor.r, blockLineColor.g, blockLineColor.b, blockLineColor.a);
-        if (sqrt(N) == floor(sqrt(N))) {
-            int blockSize = sqrt(N);
-            for (int i = 1; i < blockSize; ++i) {
-                SDL_RenderDrawLine(renderer, recx + i * blockSize * recw, recy, recx + i * blockSize * recw, recy + N * rech);
-                SDL_RenderDrawLine(renderer, recx, recy + i * blockSize * rech, recx + N * recw, recy + i * blockSize * rech);
+            // An edit redraws its cell, the cells that started or stopped clashing with it and the hints
+            if (!changedCells.empty()) {
+                for (size_t k = 0; k < changedCells.size(); ++k) {
+                    dirtyCells.push_back(SDL_Point{ changedCells[k] % N, changedCells[k] / N });
+                }
+                changedCells.clear();
+                messageDirty = 1;
             }
-        } else if (N == 9) { //Special case for 9x9
-            SDL_RenderDrawLine(renderer, recx + 3 * recw, recy, recx + 3 * recw, recy + N * rech);
-            SDL_RenderDrawLine(renderer, recx + 6 * recw, recy, recx + 6 * recw, recy + N * rech);
-            SDL_RenderDrawLine(renderer, recx, recy + 3 * rech, recx + N * recw, recy + 3 * rech);
-            SDL_RenderDrawLine(renderer, recx, recy + 6 * rech, recx + N * recw, recy + 6 * rech);
         }
 
-
-        // Draw Numbers in Grid
-        for (int i = 0; i < N; ++i) { // Use N here
-            for (int j = 0; j < N; ++j) { // Use N here
-                if (arr[j][i] != 0) {
-                    string numStr = to_string(arr[j][i]);
-                    SDL_Color textColor = { textColor.r, textColor.g, textColor.b, 255 }; // Ensure textColor is used
-                    SDL_Surface* textSurface = TTF_RenderText_Solid(font, numStr.c_str(), textColor);
-                    SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-                    SDL_Rect textRect;
-                    textRect.x = recx + (j * recw) + (recw - textSurface->w) / 2; // Center number in cell
-                    textRect.y = recy + (i * rech) + (rech - textSurface->h) / 2;
-                    SDL_QueryTexture(textTexture, nullptr, nullptr, &textRect.w, &textRect.h);
-                    SDL_RenderCopy(renderer, textTexture, nullptr, &textRect);
-                    SDL_DestroyTexture(textTexture);
-                    SDL_FreeSurface(textSurface);
+        // Pick up the solver result once the worker is done
+        if (solving == 1 && solverFinished.load()) {
+            solverThread.join();
+            solving = 0;
+            fullRedraw = 1;
+            if (solverResult) {
+                board.load(solverGrid);
+                generated = 1;
+            } else {
+                generateAnswer = 0;
+                if (solveControl.cancel.load()) {
+                    cancelled = 1;
+                } else {
+                    unsolvable = 1;
                 }
             }
         }
 
-        // Draw selected cell highlight
-        if (dxy == 1 && enterQuestion == 1) {
-            SDL_SetRenderDrawColor(renderer, selectedCellColor.r, selectedCellColor.g, selectedCellColor.b, selectedCellColor.a);
-            SDL_Rect selectedCellRect = { stpx, stpy, recw, rech };
-            SDL_RenderFillRect(renderer, &selectedCellRect);
+        if (solving == 1) {
+            messageDirty = 1;
+        }
+        if (frameTexture == nullptr && (messageDirty == 1 || presentAgain == 1 || !dirtyCells.empty())) {
+            fullRedraw = 1; // Nothing to patch without a cached frame
         }
+        if (fullRedraw == 0 && messageDirty == 0 && dirtyCells.empty() && presentAgain == 0) {
+            continue; // Nothing changed
+        }
+        SDL_SetRenderTarget(renderer, frameTexture);
 
+        if (fullRedraw == 1) {
+            SDL_SetRenderDrawColor(renderer, backgroundColor.r, backgroundColor.g, backgroundColor.b, backgroundColor.a);
+            SDL_RenderClear(renderer);
 
-        // Buttons drawing
-        SDL_SetRenderDrawColor(renderer, buttonColor.r, buttonColor.g, buttonColor.b, buttonColor.a);
-        SDL_RenderFillRect(renderer, &enterQuestionButtonRect);
-        SDL_RenderFillRect(renderer, &doneButtonRect);
-        SDL_RenderFillRect(renderer, &clearButtonRect);
-        SDL_RenderFillRect(renderer, &generateAnswerButtonRect);
-
-        SDL_SetRenderDrawColor(renderer, gridLineColor.r, gridLineColor.g, gridLineColor.b, gridLineColor.a); // Button borders same as grid lines
-        SDL_RenderDrawRect(renderer, &enterQuestionButtonRect);
-        SDL_RenderDrawRect(renderer, &doneButtonRect);
-        SDL_RenderDrawRect(renderer, &clearButtonRect);
-        SDL_RenderDrawRect(renderer, &generateAnswerButtonRect);
-
-        // Button texts rendering
-        SDL_Surface* enterQuestionTextSurface = TTF_RenderText_Solid(font, "Enter Question", buttonTextColor);
-        SDL_Texture* enterQuestionTextTexture = SDL_CreateTextureFromSurface(renderer, enterQuestionTextSurface);
-        SDL_Rect enterQuestionTextRect;
-        enterQuestionTextRect.x = enterQuestionButtonRect.x + (enterQuestionButtonRect.w - enterQuestionTextSurface->w) / 2; // Center text
-        enterQuestionTextRect.y = enterQuestionButtonRect.y + (enterQuestionButtonRect.h - enterQuestionTextSurface->h) / 2;
-        SDL_QueryTexture(enterQuestionTextTexture, nullptr, nullptr, &enterQuestionTextRect.w, &enterQuestionTextRect.h);
-        SDL_RenderCopy(renderer, enterQuestionTextTexture, nullptr, &enterQuestionTextRect);
-        SDL_DestroyTexture(enterQuestionTextTexture);
-        SDL_FreeSurface(enterQuestionTextSurface);
-
-
-        SDL_Surface* doneTextSurface = TTF_RenderText_Solid(font, "Done", buttonTextColor);
-        SDL_Texture* doneTextTexture = SDL_CreateTextureFromSurface(renderer, doneTextSurface);
-        SDL_Rect doneTextRect;
-        doneTextRect.x = doneButtonRect.x + (doneButtonRect.w - doneTextSurface->w) / 2;
-        doneTextRect.y = doneButtonRect.y + (doneButtonRect.h - doneTextSurface->h) / 2;
-        SDL_QueryTexture(doneTextTexture, nullptr, nullptr, &doneTextRect.w, &doneTextRect.h);
-        SDL_RenderCopy(renderer, doneTextTexture, nullptr, &doneTextRect);
-        SDL_DestroyTexture(doneTextTexture);
-        SDL_FreeSurface(doneTextSurface);
-
-
-        SDL_Surface* clearTextSurface = TTF_RenderText_Solid(font, "Clear", buttonTextColor);
-        SDL_Texture* clearTextTexture = SDL_CreateTextureFromSurface(renderer, clearTextSurface);
-        SDL_Rect clearTextRect;
-        clearTextRect.x = clearButtonRect.x + (clearButtonRect.w - clearTextSurface->w) / 2;
-        clearTextRect.y = clearButtonRect.y + (clearButtonRect.h - clearTextSurface->h) / 2;
-        SDL_QueryTexture(clearTextTexture, nullptr, nullptr, &clearTextRect.w, &clearTextRect.h);
-        SDL_RenderCopy(renderer, clearTextTexture, nullptr, &clearTextRect);
-        SDL_DestroyTexture(clearTextTexture);
-        SDL_FreeSurface(clearTextSurface);
-
-
-        SDL_Surface* generateAnswerTextSurface = TTF_RenderText_Solid(font, "Generate Answer", buttonTextColor);
-        SDL_Texture* generateAnswerTextTexture = SDL_CreateTextureFromSurface(renderer, generateAnswerTextSurface);
-        SDL_Rect generateAnswerTextRect;
-        generateAnswerTextRect.x = generateAnswerButtonRect.x + (generateAnswerButtonRect.w - generateAnswerTextSurface->w) / 2;
-        generateAnswerTextRect.y = generateAnswerButtonRect.y + (generateAnswerButtonRect.h - generateAnswerTextSurface->h) / 2;
-        SDL_QueryTexture(generateAnswerTextTexture, nullptr, nullptr, &generateAnswerTextRect.w, &generateAnswerTextRect.h);
-        SDL_RenderCopy(renderer, generateAnswerTextTexture, nullptr, &generateAnswerTextRect);
-        SDL_DestroyTexture(generateAnswerTextTexture);
-        SDL_FreeSurface(generateAnswerTextSurface);
-
-
-        // Messages
-        SDL_Rect messageRect = { (screenWidth - 600) / 2, 100, 600, 30 }; // Centered message area below title, adjusted position
-        if (enterQuestion == 1) {
-            SDL_Surface* messageSurface = TTF_RenderText_Solid(font, "Enter your Sudoku question in the table.", messageColor);
-            SDL_Texture* messageTexture = SDL_CreateTextureFromSurface(renderer, messageSurface);
-            messageRect.w = messageSurface->w; messageRect.h = messageSurface->h; messageRect.x = (screenWidth - messageRect.w) / 2; // Adjust message rect to text size and center
-            SDL_RenderCopy(renderer, messageTexture, nullptr, &messageRect);
-            SDL_DestroyTexture(messageTexture);
-            SDL_FreeSurface(messageSurface);
-        } else if (generateAnswer == 1 && generated != 1) {
-            if (!isValidSudoku(arr, N)) {
-                SDL_Surface* invalidInputSurface = TTF_RenderText_Solid(font, "Invalid Sudoku Input!", errorColor);
-                SDL_Texture* invalidInputTexture = SDL_CreateTextureFromSurface(renderer, invalidInputSurface);
-                messageRect.w = invalidInputSurface->w; messageRect.h = invalidInputSurface->h; messageRect.x = (screenWidth - messageRect.w) / 2; // Adjust message rect
-                SDL_RenderCopy(renderer, invalidInputTexture, nullptr, &messageRect);
-                SDL_DestroyTexture(invalidInputTexture);
-                SDL_FreeSurface(invalidInputSurface);
+            // SUDOKU SOLVER Title
+            SDL_Rect titleRect = { 0, 40, screenWidth, 0 }; // Centered title, adjusted position
+            labelCache.draw(renderer, font, "SUDOKU SOLVER BY MANISH SHRESTHA", titleColor, titleRect, false);
+
+            // Draw Sudoku Grid
+            if (gridTexture != nullptr) {
+                SDL_Rect gridRect = { recx, recy, N * recw + 1, N * rech + 1 };
+                SDL_RenderCopy(renderer, gridTexture, nullptr, &gridRect);
             } else {
-                SDL_Surface* messageSurface = TTF_RenderText_Solid(font, "Generating Answer...", messageColor);
-                SDL_Texture* messageTexture = SDL_CreateTextureFromSurface(renderer, messageSurface);
-                messageRect.w = messageSurface->w; messageRect.h = messageSurface->h; messageRect.x = (screenWidth - messageRect.w) / 2; // Adjust message rect
-                SDL_RenderCopy(renderer, messageTexture, nullptr, &messageRect);
-                SDL_DestroyTexture(messageTexture);
-                SDL_FreeSurface(messageSurface);
-                if (solveSudoku(arr, N, 0, 0)) {
-                    generated = 1;
-                } else {
-                    generated = 0;
-                    generateAnswer = 0;
-                    SDL_Surface* noSolutionSurface = TTF_RenderText_Solid(font, "Sudoku Unsolvable", messageColor);
-                    SDL_Texture* noSolutionTexture = SDL_CreateTextureFromSurface(renderer, noSolutionSurface);
-                    messageRect.w = noSolutionSurface->w; messageRect.h = noSolutionSurface->h; messageRect.x = (screenWidth - messageRect.w) / 2; // Adjust message rect
-                    SDL_RenderCopy(renderer, noSolutionTexture, nullptr, &messageRect);
-                    SDL_DestroyTexture(noSolutionTexture);
-                    SDL_FreeSurface(noSolutionSurface);
+                drawGridLines(recx, recy);
+            }
+            for (int i = 0; i < N; ++i) { // Use N here
+                for (int j = 0; j < N; ++j) { // Use N here
+                    if (board.value(i, j) != 0 || (dxy == 1 && enterQuestion == 1)) {
+                        drawCell(j, i);
+                    }
                 }
             }
-        } else if (generateAnswer == 1 && generated == 1) {
-            SDL_Surface* messageSurface = TTF_RenderText_Solid(font, "Answer Generated!", messageColor);
-            SDL_Texture* messageTexture = SDL_CreateTextureFromSurface(renderer, messageSurface);
-            messageRect.w = messageSurface->w; messageRect.h = messageSurface->h; messageRect.x = (screenWidth - messageRect.w) / 2; // Adjust message rect
-            SDL_RenderCopy(renderer, messageTexture, nullptr, &messageRect);
-            SDL_DestroyTexture(messageTexture);
-            SDL_FreeSurface(messageSurface);
-        }
-
 
+            // Buttons drawing
+            SDL_SetRenderDrawColor(renderer, buttonColor.r, buttonColor.g, buttonColor.b, buttonColor.a);
+            SDL_RenderFillRect(renderer, &enterQuestionButtonRect);
+            SDL_RenderFillRect(renderer, &doneButtonRect);
+            SDL_RenderFillRect(renderer, &clearButtonRect);
+            SDL_RenderFillRect(renderer, &generateAnswerButtonRect);
+
+            SDL_SetRenderDrawColor(renderer, gridLineColor.r, gridLineColor.g, gridLineColor.b, gridLineColor.a); // Button borders same as grid lines
+            SDL_RenderDrawRect(renderer, &enterQuestionButtonRect);
+            SDL_RenderDrawRect(renderer, &doneButtonRect);
+            SDL_RenderDrawRect(renderer, &clearButtonRect);
+            SDL_RenderDrawRect(renderer, &generateAnswerButtonRect);
+
+            // Button texts rendering
+            labelCache.draw(renderer, font, "Enter Question", buttonTextColor, enterQuestionButtonRect);
+            labelCache.draw(renderer, font, "Done", buttonTextColor, doneButtonRect);
+            labelCache.draw(renderer, font, "Clear", buttonTextColor, clearButtonRect);
+            labelCache.draw(renderer, font, solving == 1 ? "Cancel" : "Generate Answer", buttonTextColor, generateAnswerButtonRect);
+
+            // Messages
+            drawMessage();
+        } else {
+            for (size_t k = 0; k < dirtyCells.size(); ++k) {
+                drawCell(dirtyCells[k].x, dirtyCells[k].y);
+            }
+            if (messageDirty == 1) {
+                drawMessage();
+            }
+        }
+        fullRedraw = 0;
+        messageDirty = 0;
+        presentAgain = 0;
+        dirtyCells.clear();
+
+        if (frameTexture != nullptr) {
+            SDL_SetRenderTarget(renderer, nullptr);
+            SDL_RenderCopy(renderer, frameTexture, nullptr, nullptr);
+        }
         SDL_RenderPresent(renderer);
-        SDL_Delay(16);
     }
 
+    if (solving == 1) {
+        solveControl.cancel.store(true);
+        solverThread.join();
+    }
 
+    if (gridTexture != nullptr) {
+        SDL_DestroyTexture(gridTexture);
+    }
+    if (frameTexture != nullptr) {
+        SDL_DestroyTexture(frameTexture);
+    }
+    labelCache.clear();
+    glyphAtlas.destroy();
+    cellGlyphs.destroy();
+    if (cellFont != font) {
+        TTF_CloseFont(cellFont);
+    }
     TTF_CloseFont(font);
     TTF_Quit();
     SDL_DestroyRenderer(renderer);
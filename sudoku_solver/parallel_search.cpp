@@ -0,0 +1,140 @@
+#include "parallel_search.h"
+#include "propagate.h"
+#include "sudoku.h"
+#include "thread_pool.h"
+#include <cstring>
+#include <memory>
+#include <mutex>
+using namespace std;
+
+//Branch points deeper than this are never split; below it the subtrees are
+//usually too small to be worth a board copy
+const int PARALLEL_SPLIT_DEPTH = 12;
+
+//Untried digits of one cell on top of a board snapshot
+struct SearchTask {
+    vector<uint8_t> cells;
+    int cell = 0;
+    DigitMask options = 0;
+    int depth = 0;
+};
+
+struct SharedSearch : SearchSplitter {
+    WorkStealingPool& pool;
+    BoardGeometry geometry;
+    vector<PropagationSolver> solvers;      //One per worker, reused across tasks
+
+    atomic<bool> stop{false};
+    atomic<int> waiting{0};                 //Tasks submitted but not started
+    atomic<uint64_t> nodes{0};
+    atomic<uint64_t> tasks{0};
+
+    mutex resultLock;
+    vector<uint8_t> solution;
+
+    SharedSearch(WorkStealingPool& pool, const BoardGeometry& geometry)
+        : pool(pool), geometry(geometry), solvers(pool.size()) {}
+
+    bool wantsWork() override {
+        return waiting.load(memory_order_relaxed) == 0 && pool.idleWorkers() > 0
+            && !stop.load(memory_order_relaxed);
+    }
+
+    void donate(const PropagationSolver& solver, int cell, DigitMask options) override {
+        shared_ptr<SearchTask> task = make_shared<SearchTask>();
+        task->cells = solver.cells;
+        task->cell = cell;
+        task->options = options;
+        task->depth = solver.depth;
+        submit(task);
+    }
+
+    void submit(const shared_ptr<SearchTask>& task) {
+        waiting.fetch_add(1);
+        tasks.fetch_add(1);
+        pool.submit([this, task](int worker) {
+            waiting.fetch_sub(1);
+            run(*task, worker);
+        });
+    }
+
+    void run(const SearchTask& task, int worker) {
+        if (stop.load(memory_order_relaxed))
+            return;
+
+        PropagationSolver& solver = solvers[worker];
+        solver.loadCells(task.cells.data(), geometry);
+        solver.stop = &stop;
+        solver.splitter = this;
+        solver.splitDepth = PARALLEL_SPLIT_DEPTH;
+        solver.depth = task.depth;
+
+        bool found = solver.branch(task.cell, task.options);
+        nodes.fetch_add(solver.nodes);
+        if (found) {
+            lock_guard<mutex> lock(resultLock);
+            if (solution.empty())
+                solution = solver.cells;
+            stop.store(true);
+        }
+    }
+};
+
+bool solveSudokuParallel(Grid& grid, WorkStealingPool& pool, ParallelSearchStats* stats) {
+    int N = grid.N;
+    if (N > MAX_MASK_DIGITS)
+        return solveSudoku(grid, 0, 0);
+
+    //Propagate the givens once on this thread, then split from the first branch point
+    PropagationSolver root;
+    root.load(grid);
+    bool consistent = root.propagate();
+    int cell = consistent ? root.pickCell() : -1;
+    if (stats != nullptr) {
+        stats->nodes = 1;
+        stats->tasks = 0;
+    }
+    if (!consistent)
+        return false;
+    if (cell < 0) {
+        root.store(grid);
+        return true;
+    }
+
+    SharedSearch search(pool, grid.geometry);
+    shared_ptr<SearchTask> task = make_shared<SearchTask>();
+    task->cells = root.cells;
+    task->cell = cell;
+    task->options = root.candidates(cell);
+    task->depth = 1;
+    search.submit(task);
+    pool.wait();
+
+    if (stats != nullptr) {
+        stats->nodes += search.nodes.load();
+        stats->tasks = search.tasks.load();
+    }
+    if (search.solution.empty())
+        return false;
+    memcpy(grid.data(), search.solution.data(), search.solution.size());
+    return true;
+}
+
+bool solveSudokuParallel(vector<vector<int>>& rows, int N, WorkStealingPool& pool, ParallelSearchStats* stats) {
+    Grid grid(N);
+    grid.fromRows(rows, N);
+    if (!solveSudokuParallel(grid, pool, stats))
+        return false;
+    grid.toRows(rows);
+    return true;
+}
+
+bool solveSudokuParallel(Grid& grid, int threads, ParallelSearchStats* stats) {
+    WorkStealingPool pool(threads);
+    return solveSudokuParallel(grid, pool, stats);
+}
+
+bool solveSudokuParallel(vector<vector<int>>& grid, int N, int threads, ParallelSearchStats* stats) {
+    WorkStealingPool pool(threads);
+    return solveSudokuParallel(grid, N, pool, stats);
+}
@@ -0,0 +1,29 @@
+#ifndef PARALLEL_SEARCH_H
+#define PARALLEL_SEARCH_H
+
+#include <cstdint>
+#include <vector>
+#include "grid.h"
+
+class WorkStealingPool;
+
+struct ParallelSearchStats {
+    uint64_t nodes = 0;         //search() calls over all workers
+    uint64_t tasks = 0;         //Subtrees handed between threads
+};
+
+//Solves one board with the propagation engine spread over the pool's workers.
+//The search starts as one task; whenever a worker is idle, a thread at a
+//shallow branch point gives away its untried digits as a new task, so skewed
+//subtrees get split up where the work actually is. The first solution sets a
+//shared stop flag that every other worker checks at each node.
+bool solveSudokuParallel(Grid& grid, WorkStealingPool& pool, ParallelSearchStats* stats = nullptr);
+bool solveSudokuParallel(std::vector<std::vector<int>>& grid, int N, WorkStealingPool& pool,
+                         ParallelSearchStats* stats = nullptr);
+
+//Same on a temporary pool; threads = 0 uses one per core
+bool solveSudokuParallel(Grid& grid, int threads = 0, ParallelSearchStats* stats = nullptr);
+bool solveSudokuParallel(std::vector<std::vector<int>>& grid, int N, int threads = 0,
+                         ParallelSearchStats* stats = nullptr);
+
+#endif // PARALLEL_SEARCH_H
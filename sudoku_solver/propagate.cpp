@@ -0,0 +1,178 @@
+#include "propagate.h"
+using namespace std;
+
+void PropagationSolver::load(const Grid& grid) {
+    BitboardSolver::load(grid);
+    reset();
+}
+
+void PropagationSolver::loadCells(const uint8_t* flat, const BoardGeometry& shape) {
+    BitboardSolver::loadCells(flat, shape);
+    reset();
+}
+
+void PropagationSolver::reset() {
+    int units = geometry.hasBoxes() ? 3 * N : 2 * N;
+    if (units != unitCount || (int)unitCells.size() != units * N || unitGeometry != geometry) {
+        unitGeometry = geometry;
+        unitCount = units;
+        unitCells.resize(unitCount * N);
+        for (int cell = 0; cell < N * N; cell++) {
+            unitCells[rowOf[cell] * N + colOf[cell]] = cell;
+            unitCells[(N + colOf[cell]) * N + rowOf[cell]] = cell;
+            if (geometry.hasBoxes()) {
+                int inBox = geometry.inBox(rowOf[cell], colOf[cell]);
+                unitCells[(2 * N + boxOf[cell]) * N + inBox] = cell;
+            }
+        }
+    }
+
+    trail.clear();
+    emptyLeft = (int)empties.size();
+    solutions = 0;
+    guesses = 0;
+    depth = 0;
+}
+
+bool PropagationSolver::propagate() {
+    bool changed = true;
+    while (changed && emptyLeft > 0) {
+        changed = false;
+
+        //Naked singles: a cell with one candidate left
+        for (size_t k = 0; k < empties.size(); k++) {
+            int cell = empties[k];
+            if (cells[cell] != 0)
+                continue;
+            DigitMask options = candidates(cell);
+            if (options == 0)
+                return false;
+            if ((options & (options - 1)) == 0) {
+                SOLVE_COUNT(stats, nakedSingles);
+                assign(cell, lowestDigit(options));
+                changed = true;
+            }
+        }
+
+        //Hidden singles: a digit with one place left in a unit
+        for (int unit = 0; unit < unitCount && hiddenSingles; unit++) {
+            const int* members = &unitCells[unit * N];
+            DigitMask once = 0, twice = 0, used = 0;
+            for (int i = 0; i < N; i++) {
+                int cell = members[i];
+                if (cells[cell] != 0) {
+                    if (cells[cell] <= N)
+                        used |= DigitMask(1) << (cells[cell] - 1);
+                    continue;
+                }
+                DigitMask options = candidates(cell);
+                twice |= once & options;
+                once |= options;
+            }
+            if ((once | used) != allDigits)
+                return false;
+
+            DigitMask hidden = once & ~twice;
+            while (hidden) {
+                DigitMask bit = hidden & (~hidden + 1);
+                hidden &= hidden - 1;
+                int i = 0;
+                while (i < N && (cells[members[i]] != 0 || !(candidates(members[i]) & bit)))
+                    i++;
+                //The only place was taken by an earlier single in this pass
+                if (i == N)
+                    return false;
+                SOLVE_COUNT(stats, hiddenSingles);
+                assign(members[i], lowestDigit(bit));
+                changed = true;
+            }
+        }
+    }
+    return true;
+}
+
+int PropagationSolver::pickCell() const {
+    int best = -1;
+    int bestCount = N + 1;
+    for (size_t k = 0; k < empties.size(); k++) {
+        int cell = empties[k];
+        if (cells[cell] != 0)
+            continue;
+        int count = countDigits(candidates(cell));
+        if (count < bestCount) {
+            best = cell;
+            bestCount = count;
+            if (count <= 2)
+                break;
+        }
+    }
+    return best;
+}
+
+bool PropagationSolver::search() {
+    nodes++;
+    if (cancelled || pollControl(control, nodes, depth)
+        || (stop != nullptr && stop->load(memory_order_relaxed))) {
+        cancelled = true;
+        return false;
+    }
+
+    size_t mark = trail.size();
+#if SUDOKU_INSTRUMENT
+    SolveClock::time_point started = SolveClock::now();
+    bool consistent = propagate();
+    if (stats != nullptr)
+        stats->propagateSeconds += secondsSince(started);
+#else
+    bool consistent = propagate();
+#endif
+    if (!consistent) {
+        undo(mark);
+        return false;
+    }
+
+    int cell = pickCell();
+    if (cell < 0) {
+        //Full board. When counting, the first one is copied once and the
+        //search backtracks for more until the limit.
+        solutions++;
+        if (solutions == 1 && solutionLimit > 1)
+            firstSolution = cells;
+        if (solutions >= solutionLimit)
+            return true;
+        undo(mark);
+        return false;
+    }
+
+    depth++;
+    SOLVE_DEPTH(stats, depth);
+    bool found = branch(cell, candidates(cell));
+    depth--;
+    if (!found)
+        undo(mark);
+    return found;
+}
+
+bool PropagationSolver::branch(int cell, DigitMask options) {
+    while (options) {
+        int num = lowestDigit(options);
+        options &= options - 1;
+
+        //Hand the digits still to try to an idle thread and keep only this one
+        if (options && splitter != nullptr && depth <= splitDepth && splitter->wantsWork()) {
+            splitter->donate(*this, cell, options);
+            options = 0;
+        }
+
+        guesses++;
+        SOLVE_TRACE(trace, branch(nodes, cell, num, depth - 1));
+        size_t mark = trail.size();
+        assign(cell, num);
+        if (search())
+            return true;
+        undo(mark);
+        SOLVE_COUNT(stats, backtracks);
+        SOLVE_TRACE(trace, undo(nodes, depth - 1));
+    }
+    return false;
+}
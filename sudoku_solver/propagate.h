@@ -0,0 +1,73 @@
+#ifndef PROPAGATE_H
+#define PROPAGATE_H
+
+#include "bitboard.h"
+
+struct PropagationSolver;
+
+//Lets a search hand untried branches to other threads
+struct SearchSplitter {
+    virtual ~SearchSplitter() {}
+    //Cheap check, made before every branch digit at a shallow depth
+    virtual bool wantsWork() = 0;
+    //Takes over the digits in options for cell, on top of the solver's current board
+    virtual void donate(const PropagationSolver& solver, int cell, DigitMask options) = 0;
+};
+
+//Search that fills naked and hidden singles to a fixpoint after every placement
+//and branches on the empty cell with the fewest candidates. Every placement is
+//pushed on a trail so a failed branch is undone by popping back to a mark.
+struct PropagationSolver : BitboardSolver {
+    int unitCount = 0;
+    std::vector<int> unitCells;     //unitCount rows of N cells: rows, columns, boxes
+    BoardGeometry unitGeometry;     //Board unitCells was built for
+    std::vector<int> trail;         //Cells placed since load(), in order
+    int emptyLeft = 0;
+
+    bool hiddenSingles = true;      //Off, propagate() only fills naked singles
+    uint64_t guesses = 0;           //Branch digits tried
+    int depth = 0;                  //Branch points above the current node
+
+    uint64_t solutionLimit = 1;     //search() succeeds once this many boards are found
+    uint64_t solutions = 0;         //Full boards reached since load()
+    std::vector<uint8_t> firstSolution;     //Kept when solutionLimit > 1
+
+    const std::atomic<bool>* stop = nullptr;    //Abandons the search once set
+    SearchSplitter* splitter = nullptr;
+    int splitDepth = 0;             //Only branch points up to this depth are split
+
+    void load(const Grid& grid);
+    void loadCells(const uint8_t* flat, const BoardGeometry& geometry);
+
+    void assign(int cell, int num) {
+        place(cell, num);
+        trail.push_back(cell);
+        emptyLeft--;
+    }
+
+    void undo(size_t mark) {
+        while (trail.size() > mark) {
+            int cell = trail.back();
+            trail.pop_back();
+            remove(cell, cells[cell]);
+            emptyLeft++;
+        }
+    }
+
+    //Places every naked and hidden single until none is left.
+    //Returns false when some cell or digit runs out of places.
+    bool propagate();
+
+    //Empty cell with the fewest candidates, or -1 when the board is full
+    int pickCell() const;
+
+    bool search();
+    //Tries each digit of options in cell, keeping the board on success
+    bool branch(int cell, DigitMask options);
+    bool solve() { return search(); }
+
+private:
+    void reset();
+};
+
+#endif // PROPAGATE_H
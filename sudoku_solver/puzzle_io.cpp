@@ -0,0 +1,111 @@
+#include "puzzle_io.h"
+#include <cstring>
+using namespace std;
+
+int boardSizeForLength(size_t length) {
+    for (int N = 1; N <= MAX_PUZZLE_DIGITS; N++)
+        if ((size_t)N * N == length)
+            return N;
+    return 0;
+}
+
+int cellValue(char c, int N) {
+    if (c == '.' || c == '0' || c == '_' || c == '-')
+        return 0;
+    if (c >= '1' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + (N <= MAX_CASELESS_DIGITS ? 10 : 36);
+    if (c == '+')
+        return 62;
+    if (c == '/')
+        return 63;
+    if (c == '@')
+        return 64;
+    return -1;
+}
+
+bool parseCells(const char* text, int N, uint8_t* cells) {
+    for (int cell = 0; cell < N * N; cell++) {
+        int num = cellValue(text[cell], N);
+        if (num < 0 || num > N)
+            return false;
+        cells[cell] = (uint8_t)num;
+    }
+    return true;
+}
+
+bool parsePuzzle(const char* text, size_t length, Grid& grid) {
+    int N = boardSizeForLength(length);
+    if (N == 0)
+        return false;
+
+    if (grid.N != N)
+        grid.resize(N);
+    return parseCells(text, N, grid.data());
+}
+
+void formatPuzzle(const Grid& grid, string& out) {
+    const uint8_t* cells = grid.data();
+    for (int cell = 0; cell < grid.size(); cell++) {
+        int num = cells[cell];
+        out.push_back(num > 0 && num <= MAX_PUZZLE_DIGITS ? PUZZLE_ALPHABET[num - 1] : '.');
+    }
+}
+
+bool puzzleField(const char*& line, size_t& length) {
+    size_t start = 0;
+    while (start < length && (line[start] == ' ' || line[start] == '\t'))
+        start++;
+    if (start == length || line[start] == '#')
+        return false;
+    size_t stop = start;
+    while (stop < length && line[stop] != ' ' && line[stop] != '\t')
+        stop++;
+    line += start;
+    length = stop - start;
+    return true;
+}
+
+LineReader::LineReader(FILE* file, size_t bufferSize) : file(file), buffer(bufferSize) {}
+
+bool LineReader::next(const char*& line, size_t& length) {
+    while (true) {
+        char* start = buffer.data() + begin;
+        char* newline = (char*)memchr(start, '\n', end - begin);
+        if (newline != nullptr || (eof && end > begin)) {
+            length = (newline != nullptr ? newline : buffer.data() + end) - start;
+            begin += length + (newline != nullptr ? 1 : 0);
+            if (length > 0 && start[length - 1] == '\r')
+                length--;
+            line = start;
+            return true;
+        }
+        if (eof)
+            return false;
+
+        //Keep the partial line, then refill behind it
+        memmove(buffer.data(), start, end - begin);
+        end -= begin;
+        begin = 0;
+        if (end == buffer.size())
+            buffer.resize(buffer.size() * 2);
+        size_t got = fread(buffer.data() + end, 1, buffer.size() - end, file);
+        end += got;
+        if (got == 0)
+            eof = true;
+    }
+}
+
+OutputBuffer::OutputBuffer(FILE* file, size_t limit) : file(file), limit(limit) {
+    data.reserve(limit + 4096);
+}
+
+void OutputBuffer::flush() {
+    if (!data.empty()) {
+        fwrite(data.data(), 1, data.size(), file);
+        data.clear();
+    }
+}
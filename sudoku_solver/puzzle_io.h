@@ -0,0 +1,72 @@
+#ifndef PUZZLE_IO_H
+#define PUZZLE_IO_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "grid.h"
+
+//One-line puzzle format: N*N characters in row-major order. Digits go
+//1..9, then A = 10 .. Z = 35, then a = 36 .. z = 61, '+', '/' and '@' = 64.
+//Up to N = 35 letters are case-insensitive, so lowercase a = 10 there.
+//Empty cells are '.', '0', '_' or '-'.
+const char* const PUZZLE_ALPHABET = "123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz+/@";
+const int MAX_PUZZLE_DIGITS = 64;
+//Largest N whose letters are read case-insensitively
+const int MAX_CASELESS_DIGITS = 35;
+
+//Cell value of one character on a board of size N: 0 for empty, -1 when it is not a cell
+int cellValue(char c, int N);
+
+//Side of the board written on a line of that many cells, or 0
+int boardSizeForLength(size_t length);
+
+//Parses the N*N characters of a line into row-major cells. Returns false on a
+//character that is not a cell or a digit above N. The board gets the standard
+//boxes for N (see BoardGeometry::standard()).
+bool parseCells(const char* text, int N, uint8_t* cells);
+
+//Parses one puzzle line straight into the grid, reusing its buffer when N does not change
+bool parsePuzzle(const char* text, size_t length, Grid& grid);
+
+//Appends the one-line form of the board to out
+void formatPuzzle(const Grid& grid, std::string& out);
+
+//Narrows a line to its first whitespace-separated field; false for blank
+//lines and '#' comments
+bool puzzleField(const char*& line, size_t& length);
+
+//Splits a stream into lines through one large read buffer
+struct LineReader {
+    FILE* file;
+    std::vector<char> buffer;
+    size_t begin = 0;
+    size_t end = 0;
+    bool eof = false;
+
+    explicit LineReader(FILE* file, size_t bufferSize = 1 << 20);
+
+    //Next line without its terminator; the pointer stays valid until the next call
+    bool next(const char*& line, size_t& length);
+};
+
+//Collects output and writes it in large blocks
+struct OutputBuffer {
+    FILE* file;
+    std::string data;
+    size_t limit;
+
+    explicit OutputBuffer(FILE* file, size_t limit = 1 << 20);
+    ~OutputBuffer() { flush(); }
+
+    void append(const char* text, size_t length) {
+        data.append(text, length);
+        if (data.size() >= limit)
+            flush();
+    }
+    void append(const std::string& text) { append(text.data(), text.size()); }
+    void flush();
+};
+
+#endif // PUZZLE_IO_H
@@ -0,0 +1,113 @@
+#include "render_cache.h"
+using namespace std;
+
+const char FIRST_GLYPH = 32;
+const char LAST_GLYPH = 126;
+
+bool GlyphAtlas::build(SDL_Renderer* renderer, TTF_Font* font) {
+    destroy();
+    SDL_Color white = {255, 255, 255, 255};
+
+    //Measure every glyph to lay them out in one row
+    int width = 0;
+    height = 0;
+    for (int c = 0; c < 128; c++)
+        glyphs[c] = SDL_Rect{0, 0, 0, 0};
+    for (char c = FIRST_GLYPH; c <= LAST_GLYPH; c++) {
+        char text[2] = {c, '\0'};
+        int w = 0, h = 0;
+        TTF_SizeText(font, text, &w, &h);
+        glyphs[(int)c] = SDL_Rect{width, 0, w, h};
+        width += w + 1;
+        if (h > height)
+            height = h;
+    }
+
+    SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (sheet == nullptr)
+        return false;
+    for (char c = FIRST_GLYPH + 1; c <= LAST_GLYPH; c++) {
+        char text[2] = {c, '\0'};
+        SDL_Surface* glyph = TTF_RenderText_Solid(font, text, white);
+        if (glyph == nullptr)
+            continue;
+        SDL_Rect target = glyphs[(int)c];
+        SDL_BlitSurface(glyph, nullptr, sheet, &target);
+        SDL_FreeSurface(glyph);
+    }
+
+    texture = SDL_CreateTextureFromSurface(renderer, sheet);
+    SDL_FreeSurface(sheet);
+    if (texture == nullptr)
+        return false;
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+void GlyphAtlas::destroy() {
+    if (texture != nullptr) {
+        SDL_DestroyTexture(texture);
+        texture = nullptr;
+    }
+}
+
+int GlyphAtlas::textWidth(const char* text) const {
+    int width = 0;
+    for (const char* p = text; *p; p++)
+        if (*p >= FIRST_GLYPH && *p <= LAST_GLYPH)
+            width += glyphs[(int)*p].w;
+    return width;
+}
+
+void GlyphAtlas::draw(SDL_Renderer* renderer, const char* text, int x, int y, SDL_Color color) const {
+    SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+    for (const char* p = text; *p; p++) {
+        if (*p < FIRST_GLYPH || *p > LAST_GLYPH)
+            continue;
+        const SDL_Rect& source = glyphs[(int)*p];
+        SDL_Rect target = { x, y, source.w, source.h };
+        SDL_RenderCopy(renderer, texture, &source, &target);
+        x += source.w;
+    }
+}
+
+void GlyphAtlas::drawCentered(SDL_Renderer* renderer, const char* text, const SDL_Rect& area, SDL_Color color) const {
+    draw(renderer, text, area.x + (area.w - textWidth(text)) / 2, area.y + (area.h - height) / 2, color);
+}
+
+const LabelCache::Label& LabelCache::get(SDL_Renderer* renderer, TTF_Font* font, const string& text, SDL_Color color) {
+    //Same text in another color is another texture
+    string key = text;
+    key.push_back('\0');
+    key.append((const char*)&color, sizeof(color));
+
+    map<string, Label>::iterator found = labels.find(key);
+    if (found != labels.end())
+        return found->second;
+
+    Label label = { nullptr, 0, 0 };
+    SDL_Surface* surface = TTF_RenderText_Solid(font, text.c_str(), color);
+    if (surface != nullptr) {
+        label.texture = SDL_CreateTextureFromSurface(renderer, surface);
+        label.w = surface->w;
+        label.h = surface->h;
+        SDL_FreeSurface(surface);
+    }
+    return labels[key] = label;
+}
+
+void LabelCache::draw(SDL_Renderer* renderer, TTF_Font* font, const string& text, SDL_Color color,
+                      const SDL_Rect& area, bool centerY) {
+    const Label& label = get(renderer, font, text, color);
+    if (label.texture == nullptr)
+        return;
+    SDL_Rect target = { area.x + (area.w - label.w) / 2, centerY ? area.y + (area.h - label.h) / 2 : area.y, label.w, label.h };
+    SDL_RenderCopy(renderer, label.texture, nullptr, &target);
+}
+
+void LabelCache::clear() {
+    for (map<string, Label>::iterator it = labels.begin(); it != labels.end(); ++it)
+        if (it->second.texture != nullptr)
+            SDL_DestroyTexture(it->second.texture);
+    labels.clear();
+}
@@ -0,0 +1,42 @@
+#ifndef RENDER_CACHE_H
+#define RENDER_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <map>
+#include <string>
+
+//Printable ASCII rendered once into a single white texture. Text is drawn
+//glyph by glyph with SDL_RenderCopy and tinted with the texture color mod,
+//so changing numbers never create a surface or texture.
+struct GlyphAtlas {
+    SDL_Texture* texture = nullptr;
+    SDL_Rect glyphs[128];
+    int height = 0;
+
+    bool build(SDL_Renderer* renderer, TTF_Font* font);
+    void destroy();
+
+    int textWidth(const char* text) const;
+    void draw(SDL_Renderer* renderer, const char* text, int x, int y, SDL_Color color) const;
+    //Centers the text inside area
+    void drawCentered(SDL_Renderer* renderer, const char* text, const SDL_Rect& area, SDL_Color color) const;
+};
+
+//Textures for fixed strings (title, button labels, messages), rendered the
+//first time they are drawn and kept until clear()
+struct LabelCache {
+    struct Label {
+        SDL_Texture* texture;
+        int w, h;
+    };
+    std::map<std::string, Label> labels;
+
+    const Label& get(SDL_Renderer* renderer, TTF_Font* font, const std::string& text, SDL_Color color);
+    //Draws the label centered horizontally in area and vertically when centerY is set
+    void draw(SDL_Renderer* renderer, TTF_Font* font, const std::string& text, SDL_Color color,
+              const SDL_Rect& area, bool centerY = true);
+    void clear();
+};
+
+#endif // RENDER_CACHE_H
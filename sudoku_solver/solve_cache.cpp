@@ -0,0 +1,487 @@
+#include "solve_cache.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+using namespace std;
+
+const char CACHE_MAGIC[4] = { 'S', 'D', 'K', 'S' };
+const uint32_t CACHE_VERSION = 2;
+
+//First byte of a key: which canonical form follows
+enum CacheKeyKind { KEY_RELABELED = 1, KEY_SYMMETRY = 2 };
+
+//Bounds on the 9x9 search. Nearly empty or very symmetric boards tie on
+//most transforms and go past them; those are only relabeled.
+const size_t MAX_CANON_NODES = 1024;
+const int MAX_CANON_BOARDS = 4096;
+
+static void putU32(vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+static uint32_t getU32(const uint8_t* in) {
+    return in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+void BoardTransform::apply(const uint8_t* cells, uint8_t* canonical) const {
+    for (int k = 0; k < N * N; k++)
+        canonical[k] = digitTo[cells[cellFrom[k]]];
+}
+
+void BoardTransform::invert(const uint8_t* canonical, uint8_t* cells) const {
+    for (int k = 0; k < N * N; k++)
+        cells[cellFrom[k]] = digitFrom[canonical[k]];
+}
+
+//Gives the digits the board does not use the labels left over, in order,
+//and fills in the inverse. label[d] is the label already given to digit d.
+static void finishLabels(BoardTransform& transform, const uint8_t* label, int nextLabel) {
+    transform.digitTo.assign(label, label + 256);
+    for (int d = 1; d <= transform.N; d++)
+        if (transform.digitTo[d] == 0)
+            transform.digitTo[d] = nextLabel++;
+    transform.digitFrom.assign(256, 0);
+    for (int d = 1; d < 256; d++)
+        if (transform.digitTo[d] != 0)
+            transform.digitFrom[transform.digitTo[d]] = d;
+}
+
+//Key header: kind, N and the box rows (boxes of another shape are other puzzles)
+const size_t KEY_HEADER = 3;
+
+static void startKey(string& key, CacheKeyKind kind, const BoardGeometry& geometry) {
+    key.resize(KEY_HEADER + geometry.N * geometry.N);
+    key[0] = (char)kind;
+    key[1] = (char)geometry.N;
+    key[2] = (char)geometry.boxRows;
+}
+
+//Digits numbered in order of first appearance, cells left in place
+static void relabelBoard(const Grid& grid, string& key, BoardTransform& transform) {
+    int N = grid.N;
+    transform.N = N;
+    transform.cellFrom.resize(N * N);
+    startKey(key, KEY_RELABELED, grid.geometry);
+    uint8_t label[256] = {};
+    int nextLabel = 1;
+    for (int k = 0; k < N * N; k++) {
+        int num = grid.cells[k];
+        if (num != 0 && label[num] == 0)
+            label[num] = nextLabel++;
+        key[KEY_HEADER + k] = (char)label[num];
+        transform.cellFrom[k] = k;
+    }
+    finishLabels(transform, label, nextLabel);
+}
+
+//Partial transform of the 9x9 search: the rows picked so far and an order of
+//the columns in which some runs are still interchangeable
+struct CanonNode {
+    uint8_t transposed;
+    uint8_t band;           //Band the current rows come from
+    uint16_t rowsUsed;
+    uint8_t rows[9];        //Row of the (transposed) board at each canonical row
+    uint8_t cols[9];        //Column at each canonical position
+    uint8_t splits;         //Two bits per stack: a run starts at its second, third column
+    uint8_t stackTied;      //Bit s: stack s can still swap with stack s - 1
+};
+
+//How a stack's runs change with the givens of the next row: the empty cells
+//go first inside every run, which splits it. For each split pattern and set
+//of givens (bit i for the column at position i) the table holds the new
+//order of the three positions, the new splits and the row's pattern with
+//position 0 in the top bit. A table keeps the hot loop free of branches.
+struct StackStep {
+    uint8_t order[3];
+    uint8_t splits;
+    uint8_t pattern;
+};
+
+struct StackSteps {
+    StackStep step[4][8];
+
+    StackSteps() {
+        for (int splits = 0; splits < 4; splits++) {
+            for (int givens = 0; givens < 8; givens++) {
+                StackStep& entry = step[splits][givens];
+                entry.splits = (uint8_t)splits;
+                int n = 0;
+                for (int p = 0; p < 3;) {
+                    int q = p + 1;
+                    while (q < 3 && !(splits >> (q - 1) & 1))
+                        q++;
+                    int first = n;
+                    for (int i = p; i < q; i++)
+                        if (!(givens >> i & 1))
+                            entry.order[n++] = (uint8_t)i;
+                    int split = n;
+                    for (int i = p; i < q; i++)
+                        if (givens >> i & 1)
+                            entry.order[n++] = (uint8_t)i;
+                    if (split > first && split < n)
+                        entry.splits |= 1 << (split - 1);
+                    p = q;
+                }
+                entry.pattern = 0;
+                for (int i = 0; i < 3; i++)
+                    entry.pattern = (uint8_t)(entry.pattern << 1 | (givens >> entry.order[i] & 1));
+            }
+        }
+    }
+};
+
+static void swapStacks(CanonNode& node, int a, int b) {
+    for (int i = 0; i < 3; i++)
+        swap(node.cols[3 * a + i], node.cols[3 * b + i]);
+    unsigned bitsA = node.splits >> (2 * a) & 3;
+    unsigned bitsB = node.splits >> (2 * b) & 3;
+    node.splits = (uint8_t)((node.splits & ~(3u << (2 * a)) & ~(3u << (2 * b)))
+                            | bitsA << (2 * b) | bitsB << (2 * a));
+}
+
+//Orders every stack for the next row, then sorts interchangeable stacks by
+//pattern. Returns the row's givens as 9 bits, position 0 in the top bit,
+//which is the least pattern any remaining column order gives that row.
+static int refineColumns(CanonNode& node, unsigned givens, const StackSteps& steps) {
+    int pattern[3];
+    for (int s = 0; s < 3; s++) {
+        uint8_t* cols = node.cols + 3 * s;
+        unsigned bits = (givens >> cols[0] & 1) | (givens >> cols[1] & 1) << 1 | (givens >> cols[2] & 1) << 2;
+        const StackStep& step = steps.step[node.splits >> (2 * s) & 3][bits];
+        uint8_t ordered[3] = { cols[step.order[0]], cols[step.order[1]], cols[step.order[2]] };
+        memcpy(cols, ordered, 3);
+        node.splits = (uint8_t)((node.splits & ~(3u << (2 * s))) | step.splits << (2 * s));
+        pattern[s] = step.pattern;
+    }
+
+    //Two bubble passes sort up to three tied stacks
+    if (node.stackTied != 0) {
+        for (int pass = 0; pass < 2; pass++) {
+            for (int s = 1; s < 3; s++) {
+                if ((node.stackTied >> s & 1) && pattern[s] < pattern[s - 1]) {
+                    swapStacks(node, s - 1, s);
+                    swap(pattern[s], pattern[s - 1]);
+                }
+            }
+        }
+        for (int s = 1; s < 3; s++)
+            if (pattern[s] != pattern[s - 1])
+                node.stackTied &= ~(1 << s);
+    }
+    return pattern[0] << 6 | pattern[1] << 3 | pattern[2];
+}
+
+//Second phase: the least relabeled board over the tied transforms
+struct CanonBoards {
+    const uint8_t* cells;
+    const CanonNode* node;
+    int runs[12][3];        //First position, units and unit width of every interchangeable run
+    int runCount;
+    int boards = 0;
+    bool found = false;
+    uint8_t best[81];
+    uint16_t bestFrom[81];
+    uint8_t bestLabel[256] = {};     //Only the first 10 are used
+    int bestNextLabel;
+    uint8_t candidate[81];
+    uint16_t candidateFrom[81];
+};
+
+//Compares the board under one full column order with the best so far;
+//false once the bound on boards is reached
+static bool compareBoard(CanonBoards& search, const uint8_t* cols) {
+    if (++search.boards > MAX_CANON_BOARDS)
+        return false;
+    const CanonNode& node = *search.node;
+    uint8_t label[10] = {};
+    int nextLabel = 1;
+    bool better = !search.found;
+    for (int r = 0, k = 0; r < 9; r++) {
+        int row = node.rows[r];
+        for (int c = 0; c < 9; c++, k++) {
+            int from = node.transposed ? cols[c] * 9 + row : row * 9 + cols[c];
+            int num = search.cells[from];
+            if (num != 0) {
+                if (label[num] == 0)
+                    label[num] = nextLabel++;
+                num = label[num];
+            }
+            if (!better) {
+                if (num > search.best[k])
+                    return true;
+                better = num < search.best[k];
+            }
+            search.candidate[k] = num;
+            search.candidateFrom[k] = from;
+        }
+    }
+    //An equal board is a symmetry of the puzzle; either transform will do
+    if (!better)
+        return true;
+    memcpy(search.best, search.candidate, 81);
+    memcpy(search.bestFrom, search.candidateFrom, sizeof(search.bestFrom));
+    memcpy(search.bestLabel, label, sizeof(label));
+    search.bestNextLabel = nextLabel;
+    search.found = true;
+    return true;
+}
+
+//Tries every order of the interchangeable runs from run k on
+static bool permuteRuns(CanonBoards& search, int k, const uint8_t* cols) {
+    if (k == search.runCount)
+        return compareBoard(search, cols);
+    int first = search.runs[k][0], units = search.runs[k][1], width = search.runs[k][2];
+    int order[9];
+    for (int u = 0; u < units; u++)
+        order[u] = u;
+    uint8_t permuted[9];
+    do {
+        memcpy(permuted, cols, 9);
+        for (int u = 0; u < units; u++)
+            memcpy(permuted + first + u * width, cols + first + order[u] * width, width);
+        if (!permuteRuns(search, k + 1, permuted))
+            return false;
+    } while (next_permutation(order, order + units));
+    return true;
+}
+
+//Whole-group canonical form of a 9x9 board; false past the search bounds
+static bool canonicalize9(const Grid& grid, string& key, BoardTransform& transform) {
+    static const StackSteps steps;
+    const uint8_t* cells = grid.data();
+    unsigned givens[2][9] = {};
+    for (int r = 0; r < 9; r++) {
+        for (int c = 0; c < 9; c++) {
+            if (cells[r * 9 + c] > 9)
+                return false;
+            if (cells[r * 9 + c] != 0) {
+                givens[0][r] |= 1u << c;
+                givens[1][c] |= 1u << r;
+            }
+        }
+    }
+
+    static thread_local vector<CanonNode> current, next;
+    current.clear();
+    for (int t = 0; t < 2; t++) {
+        CanonNode node = {};
+        node.transposed = (uint8_t)t;
+        for (int i = 0; i < 9; i++)
+            node.cols[i] = (uint8_t)i;
+        node.stackTied = 2 | 4;
+        current.push_back(node);
+    }
+
+    //Least pattern of givens, row by row, keeping every node that ties it.
+    //Every third row starts a new band; the others stay in the node's band.
+    for (int level = 0; level < 9; level++) {
+        int best = 1 << 9;
+        next.clear();
+        for (const CanonNode& node : current) {
+            for (int r = 0; r < 9; r++) {
+                if (level % 3 == 0 ? (node.rowsUsed >> (r / 3 * 3) & 7) != 0
+                                   : (r / 3 != node.band || (node.rowsUsed >> r & 1)))
+                    continue;
+                CanonNode child = node;
+                int value = refineColumns(child, givens[node.transposed][r], steps);
+                if (value > best)
+                    continue;
+                if (value < best) {
+                    best = value;
+                    next.clear();
+                }
+                if (next.size() == MAX_CANON_NODES)
+                    return false;
+                child.rows[level] = (uint8_t)r;
+                child.rowsUsed |= 1 << r;
+                child.band = (uint8_t)(r / 3);
+                next.push_back(child);
+            }
+        }
+        swap(current, next);
+    }
+
+    //The digits decide between the nodes left and every order of the column
+    //runs and stacks that are still interchangeable
+    CanonBoards search;
+    search.cells = cells;
+    for (const CanonNode& node : current) {
+        search.node = &node;
+        search.runCount = 0;
+        for (int s = 0; s < 3;) {
+            int e = s + 1;
+            while (e < 3 && (node.stackTied >> e & 1))
+                e++;
+            if (e - s > 1) {
+                int* run = search.runs[search.runCount++];
+                run[0] = 3 * s;
+                run[1] = e - s;
+                run[2] = 3;
+            }
+            s = e;
+        }
+        for (int p = 0; p < 9;) {
+            int q = p + 1;
+            while (q % 3 != 0 && !(node.splits >> (q / 3 * 2 + q % 3 - 1) & 1))
+                q++;
+            if (q - p > 1) {
+                int* run = search.runs[search.runCount++];
+                run[0] = p;
+                run[1] = q - p;
+                run[2] = 1;
+            }
+            p = q;
+        }
+        if (!permuteRuns(search, 0, node.cols))
+            return false;
+    }
+
+    transform.N = 9;
+    transform.cellFrom.assign(search.bestFrom, search.bestFrom + 81);
+    finishLabels(transform, search.bestLabel, search.bestNextLabel);
+    startKey(key, KEY_SYMMETRY, grid.geometry);
+    memcpy(&key[KEY_HEADER], search.best, 81);
+    return true;
+}
+
+void canonicalizeBoard(const Grid& grid, string& key, BoardTransform& transform) {
+    if (grid.N != 9 || !grid.geometry.isStandard() || !canonicalize9(grid, key, transform))
+        relabelBoard(grid, key, transform);
+}
+
+bool SolveCache::solve(Grid& grid, SolveMode mode, SolveControl* control, SolveStats* stats, SolveTrace* trace) {
+    static thread_local string key;
+    static thread_local BoardTransform transform;
+    canonicalizeBoard(grid, key, transform);
+    {
+        lock_guard<mutex> guard(lock);
+        auto found = index.find(key);
+        if (found != index.end()) {
+            counters.hits++;
+            entries.splice(entries.begin(), entries, found->second);
+            const Entry& entry = *found->second;
+            if (entry.solution.empty())
+                return false;
+            transform.invert(entry.solution.data(), grid.data());
+            return true;
+        }
+        counters.misses++;
+    }
+
+    bool solved = solveSudokuWith(grid, mode, control, stats, trace);
+    //A search that was cancelled or ran out of nodes proves nothing
+    if (!solved && control != nullptr
+        && (control->cancel.load() || (control->nodeLimit != 0 && control->nodes.load() >= control->nodeLimit)))
+        return false;
+    vector<uint8_t> solution;
+    if (solved) {
+        solution.resize(grid.size());
+        transform.apply(grid.data(), solution.data());
+    }
+    lock_guard<mutex> guard(lock);
+    insert(key, move(solution));
+    return solved;
+}
+
+void SolveCache::insert(const string& key, vector<uint8_t>&& solution) {
+    auto found = index.find(key);
+    if (found != index.end()) {
+        found->second->solution = move(solution);
+        entries.splice(entries.begin(), entries, found->second);
+        return;
+    }
+    //A full cache reuses its least recently used entry
+    if (entries.size() >= capacity) {
+        auto last = prev(entries.end());
+        index.erase(last->key);
+        last->key = key;
+        last->solution = move(solution);
+        entries.splice(entries.begin(), entries, last);
+        counters.evictions++;
+    } else {
+        entries.push_front(Entry{ key, move(solution) });
+    }
+    index.emplace(entries.front().key, entries.begin());
+}
+
+size_t SolveCache::size() const {
+    lock_guard<mutex> guard(lock);
+    return entries.size();
+}
+
+SolveCacheStats SolveCache::stats() const {
+    lock_guard<mutex> guard(lock);
+    return counters;
+}
+
+//Little-endian: "SDKS", version, entry count, then per entry the key length,
+//the key, 1 if solved and the canonical solution when solved
+bool SolveCache::save(const char* path) const {
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr)
+        return false;
+    lock_guard<mutex> guard(lock);
+    vector<uint8_t> out(CACHE_MAGIC, CACHE_MAGIC + 4);
+    putU32(out, CACHE_VERSION);
+    putU32(out, (uint32_t)entries.size());
+    bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+    for (auto it = entries.rbegin(); it != entries.rend() && ok; ++it) {
+        out.clear();
+        putU32(out, (uint32_t)it->key.size());
+        out.insert(out.end(), it->key.begin(), it->key.end());
+        out.push_back(!it->solution.empty());
+        out.insert(out.end(), it->solution.begin(), it->solution.end());
+        ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+    }
+    return fclose(file) == 0 && ok;
+}
+
+bool SolveCache::load(const char* path, string* error) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        if (errno == ENOENT)
+            return true;
+        if (error != nullptr)
+            *error = "cannot open file";
+        return false;
+    }
+    auto fail = [&](const char* reason) {
+        if (error != nullptr)
+            *error = reason;
+        fclose(file);
+        return false;
+    };
+
+    uint8_t header[12];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, CACHE_MAGIC, 4) != 0)
+        return fail("not a solve cache");
+    if (getU32(header + 4) != CACHE_VERSION)
+        return fail("unsupported cache version");
+    uint32_t count = getU32(header + 8);
+
+    lock_guard<mutex> guard(lock);
+    string key;
+    for (uint32_t k = 0; k < count; k++) {
+        uint8_t length[4];
+        if (fread(length, 1, 4, file) != 4)
+            return fail("file is truncated");
+        size_t size = getU32(length);
+        if (size < KEY_HEADER || size > KEY_HEADER + 255 * 255)
+            return fail("bad entry");
+        key.resize(size);
+        uint8_t solved;
+        if (fread(&key[0], 1, size, file) != size || fread(&solved, 1, 1, file) != 1)
+            return fail("file is truncated");
+        int N = (uint8_t)key[1];
+        if (size != KEY_HEADER + N * N)
+            return fail("bad entry");
+        vector<uint8_t> solution(solved ? N * N : 0);
+        if (fread(solution.data(), 1, solution.size(), file) != solution.size())
+            return fail("file is truncated");
+        insert(key, move(solution));
+    }
+    fclose(file);
+    return true;
+}
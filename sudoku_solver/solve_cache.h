@@ -0,0 +1,85 @@
+#ifndef SOLVE_CACHE_H
+#define SOLVE_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "sudoku.h"
+
+//Relabeling of digits plus a permutation of cells that takes a board to its
+//canonical form. Solutions go through the same transform, so a solution of
+//the canonical board maps back to a solution of the original.
+struct BoardTransform {
+    int N = 0;
+    std::vector<uint16_t> cellFrom;     //Canonical cell k is original cell cellFrom[k]
+    std::vector<uint8_t> digitTo;       //Original digit -> canonical digit, 0 stays 0
+    std::vector<uint8_t> digitFrom;     //Canonical digit -> original digit
+
+    //Original board to canonical cells, and canonical cells back to a board
+    void apply(const uint8_t* cells, uint8_t* canonical) const;
+    void invert(const uint8_t* canonical, uint8_t* cells) const;
+};
+
+//Canonical form of a board as a cache key: two boards get the same key only
+//when one maps onto the other.
+//
+//A 9x9 board is taken under the whole Sudoku group (transposition, band and
+//stack swaps, row and column swaps inside them, digit relabeling): the
+//transforms with the least pattern of givens are found row by row, keeping
+//every tie, and the least board among them with digits numbered in order of
+//first appearance is the canonical one. Other sizes, and 9x9 boards with so
+//many symmetries that the search would get expensive, are only relabeled.
+//The key records which of the two it is.
+void canonicalizeBoard(const Grid& grid, std::string& key, BoardTransform& transform);
+
+//Hit and miss counters of a SolveCache
+struct SolveCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+//Bounded LRU of solve results keyed by canonical board, so a puzzle seen
+//before (relabeled, permuted or transposed) is answered without a search.
+//Unsolvable boards are remembered too. Safe to share between threads.
+class SolveCache {
+public:
+    explicit SolveCache(size_t capacity = 65536) : capacity(capacity ? capacity : 1) {}
+    SolveCache(const SolveCache&) = delete;
+    SolveCache& operator=(const SolveCache&) = delete;
+
+    //solveSudokuWith() through the cache. A board with several solutions may
+    //get a different one than the engine alone would give. Solves stopped by
+    //the control are not remembered.
+    bool solve(Grid& grid, SolveMode mode, SolveControl* control = nullptr, SolveStats* stats = nullptr,
+               SolveTrace* trace = nullptr);
+
+    //Adds the entries of a file written by save(), least recently used first.
+    //A missing file is not an error; a damaged one is.
+    bool load(const char* path, std::string* error = nullptr);
+    bool save(const char* path) const;
+
+    size_t size() const;
+    SolveCacheStats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::vector<uint8_t> solution;  //Canonical cells, empty when unsolvable
+    };
+
+    size_t capacity;
+    mutable std::mutex lock;
+    std::list<Entry> entries;           //Most recently used first
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;     //Views into entries' keys
+    SolveCacheStats counters;
+
+    //Adds or refreshes an entry; lock must be held
+    void insert(const std::string& key, std::vector<uint8_t>&& solution);
+};
+
+#endif // SOLVE_CACHE_H
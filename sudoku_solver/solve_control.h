@@ -0,0 +1,42 @@
+#ifndef SOLVE_CONTROL_H
+#define SOLVE_CONTROL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+//Shared between a solve running on a worker thread and whoever watches it.
+//The engines publish progress and check for cancel every
+//PROGRESS_INTERVAL nodes, so the hot path only pays a mask test.
+struct SolveControl {
+    std::atomic<bool> cancel{false};
+    std::atomic<uint64_t> nodes{0};     //Search nodes so far
+    std::atomic<int> depth{0};          //Depth of the node last published
+    uint64_t nodeLimit = 0;             //Gives up after this many nodes, 0 for no limit
+    //Sets cancel once the clock passes it; the default (the clock's epoch) is no deadline
+    std::chrono::steady_clock::time_point deadline;
+
+    void reset() {
+        cancel.store(false);
+        nodes.store(0);
+        depth.store(0);
+    }
+};
+
+const uint64_t PROGRESS_INTERVAL = 1024;
+
+//Publishes progress on every PROGRESS_INTERVAL-th node; true once cancelled,
+//past the node limit or past the deadline (checked at the same granularity)
+inline bool pollControl(SolveControl* control, uint64_t nodes, int depth) {
+    if (control == nullptr || (nodes & (PROGRESS_INTERVAL - 1)) != 0)
+        return false;
+    control->nodes.store(nodes, std::memory_order_relaxed);
+    control->depth.store(depth, std::memory_order_relaxed);
+    if (control->deadline != std::chrono::steady_clock::time_point()
+        && std::chrono::steady_clock::now() >= control->deadline)
+        control->cancel.store(true, std::memory_order_relaxed);
+    return control->cancel.load(std::memory_order_relaxed)
+        || (control->nodeLimit != 0 && nodes >= control->nodeLimit);
+}
+
+#endif // SOLVE_CONTROL_H
@@ -0,0 +1,649 @@
+#include "solve_service.h"
+#include "puzzle_io.h"
+#include "solve_cache.h"
+#include "solve_stats.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+//A line this long without a newline is not a request
+const size_t MAX_REQUEST_LENGTH = 1 << 16;
+const size_t READ_SIZE = 1 << 16;
+
+//Requests of one pass over the connections, solved together by one worker.
+//The request fields sit back to back in text; batches are recycled, so their
+//buffers stop allocating once the load settles. Replies that carry a deadline
+//can go out ahead of the batch in a part, a spare batch holding just those
+//items and replies.
+struct ServiceBatch {
+    struct Item {
+        uint64_t connection;
+        size_t idBegin, idEnd;
+        size_t puzzleBegin, puzzleEnd;
+        SolveClock::time_point deadline;    //The clock's epoch for none
+        size_t replyEnd;                    //End of this item's reply line in replies
+    };
+    string text;
+    vector<Item> items;
+    string replies;
+    ServiceStats stats;
+    size_t published = 0;           //Items already answered through parts
+};
+
+struct ServiceWorker {
+    Grid grid;
+    SolveControl control;
+};
+
+#ifdef _WIN32
+static void closeDescriptor(int) {}
+#else
+static void closeDescriptor(int descriptor) {
+    if (descriptor >= 0)
+        close(descriptor);
+}
+
+static bool setNonBlocking(int descriptor) {
+    int flags = fcntl(descriptor, F_GETFL, 0);
+    return flags >= 0 && fcntl(descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+//Fills a Unix socket address; false when the path does not fit
+static bool socketAddress(const char* path, sockaddr_un& address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path))
+        return false;
+    strcpy(address.sun_path, path);
+    return true;
+}
+#endif
+
+//One whitespace-separated word of text[begin, end), advancing begin past it
+static bool nextWord(const char* text, size_t& begin, size_t end, size_t& wordBegin, size_t& wordEnd) {
+    while (begin < end && (text[begin] == ' ' || text[begin] == '\t'))
+        begin++;
+    wordBegin = begin;
+    while (begin < end && text[begin] != ' ' && text[begin] != '\t')
+        begin++;
+    wordEnd = begin;
+    return wordEnd > wordBegin;
+}
+
+SolveServer::SolveServer(const ServiceOptions& options) : options(options) {
+    pool.reset(new WorkStealingPool(options.threads));
+    workers.reset(new ServiceWorker[pool->size()]);
+    filling.reset(new ServiceBatch());
+}
+
+SolveServer::~SolveServer() {
+    pool.reset();
+    for (auto& entry : connections)
+        closeDescriptor(entry.second.socket);
+    closeDescriptor(listenSocket);
+    closeDescriptor(wakePipe[0]);
+    closeDescriptor(wakePipe[1]);
+}
+
+ServiceStats SolveServer::stats() const {
+    lock_guard<mutex> guard(statsLock);
+    return counters;
+}
+
+void SolveServer::stop() {
+    stopping.store(true);
+    wake();
+}
+
+void SolveServer::submitBatch() {
+    if (filling->items.empty())
+        return;
+    ServiceBatch* batch = filling.release();
+    {
+        lock_guard<mutex> guard(statsLock);
+        counters.batches++;
+        counters.requests += batch->items.size();
+    }
+    pool->submit([this, batch](int worker) {
+        solveBatch(*batch, worker);
+        {
+            lock_guard<mutex> guard(finishedLock);
+            finished.emplace_back(batch);
+        }
+        wake();
+    });
+    filling = spareBatch();
+    filling->text.clear();
+    filling->items.clear();
+    filling->published = 0;
+}
+
+unique_ptr<ServiceBatch> SolveServer::spareBatch() {
+    {
+        lock_guard<mutex> guard(finishedLock);
+        if (!spare.empty()) {
+            unique_ptr<ServiceBatch> batch = move(spare.back());
+            spare.pop_back();
+            return batch;
+        }
+    }
+    return unique_ptr<ServiceBatch>(new ServiceBatch());
+}
+
+void SolveServer::publishReplies(ServiceBatch& batch, size_t end) {
+    unique_ptr<ServiceBatch> part = spareBatch();
+    part->items.assign(batch.items.begin() + batch.published, batch.items.begin() + end);
+    part->replies.swap(batch.replies);
+    batch.replies.clear();
+    part->stats = batch.stats;
+    batch.stats = ServiceStats();
+    part->published = 0;
+    batch.published = end;
+    {
+        lock_guard<mutex> guard(finishedLock);
+        finished.push_back(move(part));
+    }
+    wake();
+}
+
+void SolveServer::solveBatch(ServiceBatch& batch, int worker) {
+    ServiceWorker& state = workers[worker];
+    Grid& grid = state.grid;
+    SolveControl& control = state.control;
+    const char* text = batch.text.data();
+    batch.replies.clear();
+    batch.stats = ServiceStats();
+    batch.published = 0;
+    bool holdingDeadlines = false;      //Replies in batch.replies whose requests gave a deadline
+    for (size_t k = 0; k < batch.items.size(); k++) {
+        ServiceBatch::Item& item = batch.items[k];
+        bool hasDeadline = item.deadline != SolveClock::time_point();
+        bool late = hasDeadline && SolveClock::now() >= item.deadline;
+        //A search can run up to its own deadline; replies that have one do
+        //not wait for it
+        if (!late && holdingDeadlines) {
+            publishReplies(batch, k);
+            holdingDeadlines = false;
+        }
+        holdingDeadlines |= hasDeadline;
+        batch.replies.append(text + item.idBegin, item.idEnd - item.idBegin);
+        batch.replies += ' ';
+        //Requests that waited past their deadline are not started
+        if (late) {
+            batch.replies += "timeout\n";
+            batch.stats.timedOut++;
+            item.replyEnd = batch.replies.size();
+            continue;
+        }
+        bool valid = parsePuzzle(text + item.puzzleBegin, item.puzzleEnd - item.puzzleBegin, grid);
+        if (valid && grid.N == options.boxes.N)
+            grid.geometry = options.boxes;
+        if (!valid || !isValidSudoku(grid)) {
+            batch.replies += "invalid";
+            batch.stats.invalid++;
+        } else {
+            control.reset();
+            control.deadline = item.deadline;
+            bool solved = options.cache != nullptr ? options.cache->solve(grid, options.mode, &control)
+                                                   : solveSudokuWith(grid, options.mode, &control);
+            if (solved) {
+                formatPuzzle(grid, batch.replies);
+                batch.stats.solved++;
+            } else if (control.cancel.load()) {
+                batch.replies += "timeout";
+                batch.stats.timedOut++;
+            } else {
+                batch.replies += "unsolvable";
+                batch.stats.unsolvable++;
+            }
+        }
+        batch.replies += '\n';
+        item.replyEnd = batch.replies.size();
+    }
+}
+
+#ifdef _WIN32
+
+static bool unsupported(string* error) {
+    if (error != nullptr)
+        *error = "Unix domain sockets are not supported on this platform";
+    return false;
+}
+
+bool SolveServer::listen(const char*, string* error) {
+    return unsupported(error);
+}
+
+void SolveServer::run() {}
+
+void SolveServer::wake() {}
+
+bool solveRemote(const char*, FILE*, FILE*, const RemoteOptions&, RemoteStats&, string* error) {
+    return unsupported(error);
+}
+
+#else
+
+bool SolveServer::listen(const char* path, string* error) {
+    auto fail = [&](const char* reason) {
+        if (error != nullptr)
+            *error = string(reason) + (errno != 0 ? string(": ") + strerror(errno) : string());
+        return false;
+    };
+    errno = 0;
+    sockaddr_un address;
+    if (!socketAddress(path, address))
+        return fail("socket path is too long");
+    if (pipe(wakePipe) != 0 || !setNonBlocking(wakePipe[0]) || !setNonBlocking(wakePipe[1]))
+        return fail("cannot create wake-up pipe");
+
+    //A socket file nobody answers on is left over from a server that died
+    struct stat status;
+    if (lstat(path, &status) == 0) {
+        if (!S_ISSOCK(status.st_mode)) {
+            errno = 0;
+            return fail("path exists and is not a socket");
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool live = probe >= 0 && connect(probe, (const sockaddr*)&address, sizeof(address)) == 0;
+        closeDescriptor(probe);
+        if (live) {
+            errno = 0;
+            return fail("another server is listening on this socket");
+        }
+        unlink(path);
+    }
+
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0)
+        return fail("cannot create socket");
+    if (bind(listenSocket, (const sockaddr*)&address, sizeof(address)) != 0)
+        return fail("cannot bind socket");
+    socketPath = path;
+    if (::listen(listenSocket, SOMAXCONN) != 0 || !setNonBlocking(listenSocket))
+        return fail("cannot listen on socket");
+    return true;
+}
+
+void SolveServer::wake() {
+    //One byte in the pipe is enough until the I/O thread has drained it
+    if (!wakePending.exchange(true)) {
+        char byte = 1;
+        ssize_t written = write(wakePipe[1], &byte, 1);
+        (void)written;
+    }
+}
+
+void SolveServer::acceptConnections() {
+    while (true) {
+        int client = accept(listenSocket, nullptr, nullptr);
+        if (client < 0)
+            return;
+        if (!setNonBlocking(client)) {
+            close(client);
+            continue;
+        }
+        connections[nextConnection++].socket = client;
+        lock_guard<mutex> guard(statsLock);
+        counters.connections++;
+    }
+}
+
+bool SolveServer::readConnection(Connection& connection) {
+    size_t size = connection.input.size();
+    connection.input.resize(size + READ_SIZE);
+    ssize_t got = read(connection.socket, &connection.input[size], READ_SIZE);
+    connection.input.resize(size + (got > 0 ? got : 0));
+    if (got == 0)
+        connection.readClosed = true;
+    return got >= 0 || errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+bool SolveServer::takeRequests(uint64_t id, Connection& connection) {
+    const char* input = connection.input.data();
+    size_t size = connection.input.size();
+    size_t begin = 0;
+    SolveClock::time_point now = SolveClock::now();
+    while (pending < options.maxPending && connection.pending < options.maxConnectionPending) {
+        const char* newline = (const char*)memchr(input + begin, '\n', size - begin);
+        if (newline == nullptr)
+            break;
+        size_t end = newline - input;
+        size_t next = end + 1;
+        if (end > begin && input[end - 1] == '\r')
+            end--;
+
+        size_t idBegin, idEnd, puzzleBegin, puzzleEnd, deadlineBegin, deadlineEnd;
+        size_t position = begin;
+        begin = next;
+        if (!nextWord(input, position, end, idBegin, idEnd) || input[idBegin] == '#')
+            continue;
+        if (!nextWord(input, position, end, puzzleBegin, puzzleEnd))
+            puzzleBegin = puzzleEnd = idEnd;
+        uint64_t deadlineMicros = options.deadlineMicros;
+        if (nextWord(input, position, end, deadlineBegin, deadlineEnd))
+            deadlineMicros = strtoull(string(input + deadlineBegin, deadlineEnd - deadlineBegin).c_str(), nullptr, 10);
+
+        ServiceBatch& batch = *filling;
+        ServiceBatch::Item item;
+        item.connection = id;
+        item.idBegin = batch.text.size();
+        batch.text.append(input + idBegin, idEnd - idBegin);
+        item.idEnd = batch.text.size();
+        item.puzzleBegin = item.idEnd;
+        batch.text.append(input + puzzleBegin, puzzleEnd - puzzleBegin);
+        item.puzzleEnd = batch.text.size();
+        item.deadline = deadlineMicros > 0 ? now + chrono::microseconds(deadlineMicros) : SolveClock::time_point();
+        item.replyEnd = 0;
+        batch.items.push_back(item);
+        connection.pending++;
+        pending++;
+        if (batch.items.size() >= batchLimit)
+            submitBatch();
+    }
+    connection.input.erase(0, begin);
+    return connection.input.size() < MAX_REQUEST_LENGTH || memchr(connection.input.data(), '\n', connection.input.size());
+}
+
+void SolveServer::collectFinished() {
+    wakePending.store(false);
+    char drain[256];
+    while (read(wakePipe[0], drain, sizeof(drain)) > 0) {
+    }
+
+    vector<unique_ptr<ServiceBatch>> done;
+    {
+        lock_guard<mutex> guard(finishedLock);
+        done.swap(finished);
+    }
+    for (unique_ptr<ServiceBatch>& batch : done) {
+        size_t replyBegin = 0;
+        for (size_t k = batch->published; k < batch->items.size(); k++) {
+            const ServiceBatch::Item& item = batch->items[k];
+            auto found = connections.find(item.connection);
+            if (found != connections.end()) {
+                found->second.output.append(batch->replies, replyBegin, item.replyEnd - replyBegin);
+                found->second.pending--;
+            }
+            replyBegin = item.replyEnd;
+        }
+        pending -= batch->items.size() - batch->published;
+        {
+            lock_guard<mutex> guard(statsLock);
+            counters.solved += batch->stats.solved;
+            counters.invalid += batch->stats.invalid;
+            counters.unsolvable += batch->stats.unsolvable;
+            counters.timedOut += batch->stats.timedOut;
+        }
+    }
+    lock_guard<mutex> guard(finishedLock);
+    for (unique_ptr<ServiceBatch>& batch : done)
+        spare.push_back(move(batch));
+}
+
+bool SolveServer::writeConnection(Connection& connection) {
+    size_t sent = 0;
+    while (sent < connection.output.size()) {
+        ssize_t wrote = send(connection.socket, connection.output.data() + sent, connection.output.size() - sent,
+                             MSG_NOSIGNAL);
+        if (wrote < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return false;
+            break;
+        }
+        sent += wrote;
+    }
+    connection.output.erase(0, sent);
+    return true;
+}
+
+void SolveServer::closeConnection(uint64_t id) {
+    auto found = connections.find(id);
+    if (found == connections.end())
+        return;
+    close(found->second.socket);
+    connections.erase(found);
+}
+
+void SolveServer::run() {
+    vector<pollfd> polled;
+    vector<uint64_t> polledIds;
+    vector<uint64_t> closing;
+    while (!(stopping.load() && pending == 0)) {
+        bool accepting = !stopping.load();
+        polled.clear();
+        polledIds.clear();
+        polled.push_back(pollfd{ wakePipe[0], POLLIN, 0 });
+        polled.push_back(pollfd{ accepting ? listenSocket : -1, POLLIN, 0 });
+        for (auto& entry : connections) {
+            Connection& connection = entry.second;
+            short events = 0;
+            if (accepting && !connection.readClosed && pending < options.maxPending
+                && connection.pending < options.maxConnectionPending)
+                events |= POLLIN;
+            if (!connection.output.empty())
+                events |= POLLOUT;
+            //A hung-up socket reports POLLHUP even with no events asked for,
+            //so one that is not being read or written is left out
+            polled.push_back(pollfd{ events != 0 ? connection.socket : -1, events, 0 });
+            polledIds.push_back(entry.first);
+        }
+        if (poll(polled.data(), polled.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (polled[0].revents != 0)
+            collectFinished();
+        if (polled[1].revents & POLLIN)
+            acceptConnections();
+
+        closing.clear();
+        for (size_t k = 2; k < polled.size(); k++) {
+            uint64_t id = polledIds[k - 2];
+            if ((polled[k].revents & (POLLIN | POLLHUP | POLLERR)) && (polled[k].events & POLLIN)
+                && !readConnection(connections[id]))
+                closing.push_back(id);
+        }
+
+        //A burst is spread over every worker; a trickle still goes out at once
+        size_t lines = 0;
+        for (auto& entry : connections)
+            lines += count(entry.second.input.begin(), entry.second.input.end(), '\n');
+        batchLimit = max<size_t>(1, min(options.maxBatch, (lines + pool->size() - 1) / pool->size()));
+
+        //Requests waiting in the buffers go in as soon as the limits allow,
+        //and replies are written straight away rather than on the next pass
+        for (auto& entry : connections) {
+            Connection& connection = entry.second;
+            if (find(closing.begin(), closing.end(), entry.first) != closing.end())
+                continue;
+            if (!stopping.load() && !connection.input.empty() && !takeRequests(entry.first, connection)) {
+                closing.push_back(entry.first);
+                continue;
+            }
+            if (!connection.output.empty() && !writeConnection(connection)) {
+                closing.push_back(entry.first);
+                continue;
+            }
+            if (connection.readClosed && connection.pending == 0 && connection.output.empty())
+                closing.push_back(entry.first);
+        }
+        for (uint64_t id : closing)
+            closeConnection(id);
+        submitBatch();
+    }
+
+    for (auto& entry : connections) {
+        writeConnection(entry.second);
+        close(entry.second.socket);
+    }
+    connections.clear();
+    if (listenSocket >= 0) {
+        close(listenSocket);
+        listenSocket = -1;
+        unlink(socketPath.c_str());
+    }
+}
+
+bool solveRemote(const char* path, FILE* in, FILE* out, const RemoteOptions& options, RemoteStats& stats,
+                 string* error) {
+    int server = -1;
+    auto fail = [&](const char* reason) {
+        if (error != nullptr)
+            *error = string(reason) + (errno != 0 ? string(": ") + strerror(errno) : string());
+        closeDescriptor(server);
+        return false;
+    };
+    errno = 0;
+    sockaddr_un address;
+    if (!socketAddress(path, address))
+        return fail("socket path is too long");
+    server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0 || connect(server, (const sockaddr*)&address, sizeof(address)) != 0)
+        return fail("cannot connect");
+    if (!setNonBlocking(server))
+        return fail("cannot set up socket");
+
+    //Request k (counting from 0) has ID k and lives in slot k % window until
+    //its reply has been written out in order
+    size_t window = max<size_t>(1, options.window);
+    vector<SolveClock::time_point> sentAt(window);
+    vector<string> replies(window);
+    vector<char> answered(window, 0);
+    uint64_t nextId = 0, nextOut = 0;
+    bool inputDone = false, shutDown = false;
+
+    LineReader reader(in);
+    OutputBuffer writer(out);
+    string sending, received;
+    size_t sendBegin = 0;
+    string deadline = options.deadlineMicros > 0 ? " " + to_string(options.deadlineMicros) : string();
+    SolveClock::time_point start = SolveClock::now();
+    char buffer[READ_SIZE];
+
+    while (!inputDone || nextOut < nextId) {
+        while (!inputDone && nextId - nextOut < window) {
+            const char* line;
+            size_t length;
+            bool got = false;
+            while (!got && reader.next(line, length))
+                got = puzzleField(line, length);
+            if (!got) {
+                inputDone = true;
+                break;
+            }
+            sending += to_string(nextId);
+            sending += ' ';
+            sending.append(line, length);
+            sending += deadline;
+            sending += '\n';
+            sentAt[nextId % window] = SolveClock::now();
+            stats.latencyMicros.push_back(0);
+            nextId++;
+        }
+        while (sendBegin < sending.size()) {
+            ssize_t wrote = send(server, sending.data() + sendBegin, sending.size() - sendBegin, MSG_NOSIGNAL);
+            if (wrote < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    return fail("cannot send");
+                break;
+            }
+            sendBegin += wrote;
+        }
+        if (sendBegin == sending.size()) {
+            sending.clear();
+            sendBegin = 0;
+            if (inputDone && !shutDown) {
+                shutdown(server, SHUT_WR);
+                shutDown = true;
+            }
+        }
+        if (inputDone && nextOut == nextId)
+            break;
+
+        pollfd polled = { server, (short)(POLLIN | (sending.empty() ? 0 : POLLOUT)), 0 };
+        if (poll(&polled, 1, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            return fail("poll failed");
+        }
+        if (!(polled.revents & (POLLIN | POLLHUP | POLLERR)))
+            continue;
+        ssize_t got = read(server, buffer, sizeof(buffer));
+        if (got < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                continue;
+            return fail("cannot receive");
+        }
+        if (got == 0) {
+            errno = 0;
+            return fail("server closed the connection");
+        }
+        received.append(buffer, got);
+
+        size_t begin = 0;
+        while (true) {
+            size_t newline = received.find('\n', begin);
+            if (newline == string::npos)
+                break;
+            size_t space = received.find(' ', begin);
+            uint64_t id = strtoull(received.c_str() + begin, nullptr, 10);
+            if (space == string::npos || space > newline || id < nextOut || id >= nextId) {
+                errno = 0;
+                return fail("bad reply");
+            }
+            size_t slot = id % window;
+            stats.latencyMicros[id] = chrono::duration<double, micro>(SolveClock::now() - sentAt[slot]).count();
+            replies[slot].assign(received, space + 1, newline - space - 1);
+            answered[slot] = 1;
+            begin = newline + 1;
+        }
+        received.erase(0, begin);
+
+        //Replies go out in input order
+        while (nextOut < nextId && answered[nextOut % window]) {
+            size_t slot = nextOut % window;
+            const string& reply = replies[slot];
+            if (reply == "invalid")
+                stats.invalid++;
+            else if (reply == "unsolvable")
+                stats.unsolvable++;
+            else if (reply == "timeout")
+                stats.timedOut++;
+            else
+                stats.solved++;
+            writer.append(reply);
+            writer.append("\n", 1);
+            answered[slot] = 0;
+            nextOut++;
+        }
+    }
+    writer.flush();
+    close(server);
+    stats.puzzles = nextId;
+    stats.seconds = secondsSince(start);
+    return true;
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef SOLVE_SERVICE_H
+#define SOLVE_SERVICE_H
+
+#include "sudoku.h"
+#include "geometry.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class SolveCache;
+class WorkStealingPool;
+
+//Line protocol of the solve service. A request is
+//
+//    ID PUZZLE [DEADLINE_US]
+//
+//where ID is any word without spaces, PUZZLE is a one-line board (see
+//puzzle_io.h) and DEADLINE_US optionally limits the time from arrival to
+//answer in microseconds. The reply is
+//
+//    ID RESULT
+//
+//with RESULT the solved board, "invalid", "unsolvable" or "timeout". Replies
+//come back as their batch finishes, not necessarily in request order; those
+//of requests with a deadline come back as soon as they are solved.
+
+struct ServiceOptions {
+    SolveMode mode = SOLVE_PROPAGATE;
+    int threads = 0;                //Solver workers, 0 picks one per core
+    size_t maxBatch = 64;           //Most requests handed to a worker at once
+    size_t maxPending = 8192;       //Requests in the server unanswered; reading stops above it
+    size_t maxConnectionPending = 1024;     //Same for one connection
+    uint64_t deadlineMicros = 0;    //Deadline for requests that give none, 0 for none
+    SolveCache* cache = nullptr;    //Solves go through this cache when set
+    BoardGeometry boxes;            //Box shape for boards of size boxes.N
+};
+
+struct ServiceStats {
+    uint64_t connections = 0;
+    uint64_t requests = 0;
+    uint64_t solved = 0;
+    uint64_t invalid = 0;           //Malformed request or isValidSudoku() rejected it
+    uint64_t unsolvable = 0;
+    uint64_t timedOut = 0;
+    uint64_t batches = 0;
+};
+
+struct ServiceBatch;
+struct ServiceWorker;
+
+//Long-running solver on a Unix domain socket. One thread does all socket I/O
+//with poll(): the requests read in one pass over the connections are split
+//evenly into batches for a pool of solver threads, and finished batches come
+//back through a wake-up pipe. Back-pressure is flow control: past maxPending
+//(or maxConnectionPending) the server stops reading, so the socket buffers
+//fill and clients block on write.
+class SolveServer {
+public:
+    explicit SolveServer(const ServiceOptions& options);
+    ~SolveServer();
+    SolveServer(const SolveServer&) = delete;
+    SolveServer& operator=(const SolveServer&) = delete;
+
+    //Binds and listens on path, replacing a stale socket file there
+    bool listen(const char* path, std::string* error = nullptr);
+
+    //Serves until stop(); the socket file is removed on the way out
+    void run();
+
+    //Makes run() return once the batches in flight are answered. Safe from
+    //another thread and from a signal handler.
+    void stop();
+
+    ServiceStats stats() const;
+
+private:
+    struct Connection {
+        int socket = -1;
+        std::string input;          //Bytes read but not yet taken as requests
+        std::string output;         //Replies not yet written
+        size_t pending = 0;         //Requests taken and not answered
+        bool readClosed = false;    //Peer shut down its side; close once everything is answered
+    };
+
+    ServiceOptions options;
+    std::string socketPath;
+    int listenSocket = -1;
+    int wakePipe[2] = { -1, -1 };
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> wakePending{false};
+
+    std::unordered_map<uint64_t, Connection> connections;
+    uint64_t nextConnection = 1;
+    size_t pending = 0;
+    size_t batchLimit = 1;          //Batch size of the current pass, at most maxBatch
+
+    std::unique_ptr<WorkStealingPool> pool;
+    std::unique_ptr<ServiceBatch> filling;  //Requests of the current pass
+    std::mutex finishedLock;        //Guards finished and spare
+    std::vector<std::unique_ptr<ServiceBatch>> finished;   //Solved, waiting for the I/O thread
+    std::vector<std::unique_ptr<ServiceBatch>> spare;      //Answered, reused for batches and parts
+    std::unique_ptr<ServiceWorker[]> workers;              //Board and control per pool worker
+
+    mutable std::mutex statsLock;
+    ServiceStats counters;
+
+    void acceptConnections();
+    //Reads what the socket has; false when the connection failed
+    bool readConnection(Connection& connection);
+    //Moves complete request lines from the input into the filling batch while
+    //the limits allow; false when a line grows past any sensible length
+    bool takeRequests(uint64_t id, Connection& connection);
+    void submitBatch();
+    std::unique_ptr<ServiceBatch> spareBatch();
+    void solveBatch(ServiceBatch& batch, int worker);
+    //Hands the replies of items [batch.published, end) to the I/O thread in a
+    //part, ahead of the rest of the batch
+    void publishReplies(ServiceBatch& batch, size_t end);
+    void collectFinished();
+    bool writeConnection(Connection& connection);
+    void closeConnection(uint64_t id);
+    void wake();
+};
+
+//Client side: sends every puzzle line of in to the server at path, keeping up
+//to window requests in flight, and writes the replies to out in input order.
+struct RemoteOptions {
+    size_t window = 256;            //Requests sent but not answered
+    uint64_t deadlineMicros = 0;    //Sent with every request when above 0
+};
+
+struct RemoteStats {
+    uint64_t puzzles = 0;
+    uint64_t solved = 0;
+    uint64_t invalid = 0;
+    uint64_t unsolvable = 0;
+    uint64_t timedOut = 0;
+    double seconds = 0;
+    std::vector<double> latencyMicros;      //Send to reply, per puzzle in input order
+};
+
+bool solveRemote(const char* path, FILE* in, FILE* out, const RemoteOptions& options, RemoteStats& stats,
+                 std::string* error = nullptr);
+
+#endif // SOLVE_SERVICE_H
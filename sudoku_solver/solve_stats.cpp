@@ -0,0 +1,94 @@
+#include "solve_stats.h"
+#include <algorithm>
+using namespace std;
+
+void SolveStats::add(const SolveStats& other) {
+    solves += other.solves;
+    nodes += other.nodes;
+    guesses += other.guesses;
+    backtracks += other.backtracks;
+    maxDepth = max(maxDepth, other.maxDepth);
+    candidateChecks += other.candidateChecks;
+    nakedSingles += other.nakedSingles;
+    hiddenSingles += other.hiddenSingles;
+    loadSeconds += other.loadSeconds;
+    searchSeconds += other.searchSeconds;
+    propagateSeconds += other.propagateSeconds;
+}
+
+void SolveStats::print(FILE* out) const {
+    fprintf(out, "solves %llu\n", (unsigned long long)solves);
+    fprintf(out, "nodes %llu\n", (unsigned long long)nodes);
+    fprintf(out, "guesses %llu\n", (unsigned long long)guesses);
+    if (SOLVE_INSTRUMENTED) {
+        fprintf(out, "backtracks %llu\n", (unsigned long long)backtracks);
+        fprintf(out, "max_depth %llu\n", (unsigned long long)maxDepth);
+        fprintf(out, "candidate_checks %llu\n", (unsigned long long)candidateChecks);
+        fprintf(out, "naked_singles %llu\n", (unsigned long long)nakedSingles);
+        fprintf(out, "hidden_singles %llu\n", (unsigned long long)hiddenSingles);
+    }
+    fprintf(out, "load_seconds %.6f\n", loadSeconds);
+    fprintf(out, "search_seconds %.6f\n", searchSeconds);
+    if (SOLVE_INSTRUMENTED)
+        fprintf(out, "propagate_seconds %.6f\n", propagateSeconds);
+}
+
+void SolveTrace::writeJson(FILE* out) const {
+    fprintf(out, "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"truncated\": %s}, \"traceEvents\": [\n",
+            truncated ? "true" : "false");
+    const char* separator = "";
+    uint64_t track = 0;
+    int N = 0;
+    uint64_t lastNode = 0;
+    int open = 0;
+    //Guesses still open when a puzzle ends were on the solution path (or cut
+    //off by truncation); they are closed at the puzzle's last node
+    auto closeOpen = [&]() {
+        for (; open > 0; open--) {
+            fprintf(out, "%s{\"ph\": \"E\", \"pid\": 1, \"tid\": %llu, \"ts\": %llu}",
+                    separator, (unsigned long long)track, (unsigned long long)lastNode);
+            separator = ",\n";
+        }
+    };
+
+    for (size_t k = 0; k < events.size(); k++) {
+        const Event& event = events[k];
+        switch (event.kind) {
+        case TRACE_PUZZLE:
+            closeOpen();
+            track = event.node;
+            N = event.cell;
+            lastNode = 0;
+            fprintf(out, "%s{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %llu, "
+                         "\"args\": {\"name\": \"puzzle %llu\"}}",
+                    separator, (unsigned long long)track, (unsigned long long)track);
+            break;
+        case TRACE_BRANCH:
+            lastNode = event.node;
+            fprintf(out, "%s{\"ph\": \"B\", \"name\": \"r%dc%d=%d\", \"pid\": 1, \"tid\": %llu, \"ts\": %llu, "
+                         "\"args\": {\"depth\": %d}}",
+                    separator, N ? event.cell / N + 1 : 0, N ? event.cell % N + 1 : 0, event.digit,
+                    (unsigned long long)track, (unsigned long long)event.node, event.depth);
+            open++;
+            break;
+        case TRACE_UNDO:
+            if (open == 0)
+                continue;
+            lastNode = event.node;
+            fprintf(out, "%s{\"ph\": \"E\", \"pid\": 1, \"tid\": %llu, \"ts\": %llu}",
+                    separator, (unsigned long long)track, (unsigned long long)event.node);
+            open--;
+            break;
+        case TRACE_END:
+            lastNode = max(lastNode, event.node);
+            closeOpen();
+            fprintf(out, "%s{\"ph\": \"i\", \"s\": \"t\", \"name\": \"%s\", \"pid\": 1, \"tid\": %llu, \"ts\": %llu}",
+                    separator, event.cell ? "solved" : "failed",
+                    (unsigned long long)track, (unsigned long long)event.node);
+            break;
+        }
+        separator = ",\n";
+    }
+    closeOpen();
+    fprintf(out, "\n]}\n");
+}
@@ -0,0 +1,98 @@
+#ifndef SOLVE_STATS_H
+#define SOLVE_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+//Build with SUDOKU_INSTRUMENT=1 (cmake -DSUDOKU_INSTRUMENT=ON) to count inside
+//the search loops. Otherwise the SOLVE_* macros below expand to nothing and
+//the engines compile exactly as without them.
+#ifndef SUDOKU_INSTRUMENT
+#define SUDOKU_INSTRUMENT 0
+#endif
+
+const bool SOLVE_INSTRUMENTED = SUDOKU_INSTRUMENT != 0;
+
+typedef std::chrono::steady_clock SolveClock;
+
+inline double secondsSince(SolveClock::time_point start) {
+    return std::chrono::duration<double>(SolveClock::now() - start).count();
+}
+
+//What a solve did. Counters add up over calls, so one struct can total a
+//whole batch. nodes and the load/search times are always filled, and so are
+//guesses for the propagation engine; the rest stay 0 unless the build is
+//instrumented.
+struct SolveStats {
+    uint64_t solves = 0;
+    uint64_t nodes = 0;             //search() calls
+    uint64_t guesses = 0;           //Branch digits tried
+    uint64_t backtracks = 0;        //Branch digits undone after their subtree failed
+    uint64_t maxDepth = 0;          //Deepest branch point reached
+    uint64_t candidateChecks = 0;   //Candidate masks computed (DLX: columns scanned)
+    uint64_t nakedSingles = 0;      //Cells placed by propagation
+    uint64_t hiddenSingles = 0;
+    double loadSeconds = 0;         //Copying the board in and covering the givens
+    double searchSeconds = 0;       //Includes propagateSeconds
+    double propagateSeconds = 0;
+
+    void add(const SolveStats& other);
+    //One "name value" pair per line
+    void print(FILE* out) const;
+};
+
+//Branching decisions of one or more solves, recorded as the search enters and
+//leaves each guess. writeJson() emits Chrome trace events (chrome://tracing,
+//Perfetto, speedscope) with one track per puzzle and the node number as the
+//timestamp, so the width of a guess is the size of its subtree.
+struct SolveTrace {
+    enum Kind : uint8_t { TRACE_PUZZLE, TRACE_BRANCH, TRACE_UNDO, TRACE_END };
+    struct Event {
+        uint64_t node;      //Node count when the event happened; the puzzle number for TRACE_PUZZLE
+        int32_t cell;       //N for TRACE_PUZZLE, 1 if solved for TRACE_END
+        uint16_t depth;
+        uint8_t digit;
+        uint8_t kind;
+    };
+
+    std::vector<Event> events;
+    size_t maxEvents = 1 << 22;     //Recording stops here and sets truncated
+    bool truncated = false;
+    uint64_t puzzle = 0;            //Track of the next beginPuzzle(), set by the caller
+
+    void beginPuzzle(int N) { record(puzzle, N, 0, 0, TRACE_PUZZLE); }
+    void endPuzzle(uint64_t nodes, bool solved) { record(nodes, solved, 0, 0, TRACE_END); }
+    void branch(uint64_t node, int cell, int digit, int depth) { record(node, cell, digit, depth, TRACE_BRANCH); }
+    void undo(uint64_t node, int depth) { record(node, -1, 0, depth, TRACE_UNDO); }
+
+    void clear() {
+        events.clear();
+        truncated = false;
+    }
+    void writeJson(FILE* out) const;
+
+private:
+    void record(uint64_t node, int cell, int digit, int depth, Kind kind) {
+        if (events.size() >= maxEvents) {
+            truncated = true;
+            return;
+        }
+        Event event = { node, cell, (uint16_t)depth, (uint8_t)digit, (uint8_t)kind };
+        events.push_back(event);
+    }
+};
+
+#if SUDOKU_INSTRUMENT
+#define SOLVE_COUNT(stats, field) do { if (stats) (stats)->field++; } while (0)
+#define SOLVE_DEPTH(stats, depth) \
+    do { if ((stats) && (uint64_t)(depth) > (stats)->maxDepth) (stats)->maxDepth = (depth); } while (0)
+#define SOLVE_TRACE(trace, call) do { if (trace) (trace)->call; } while (0)
+#else
+#define SOLVE_COUNT(stats, field) do {} while (0)
+#define SOLVE_DEPTH(stats, depth) do {} while (0)
+#define SOLVE_TRACE(trace, call) do {} while (0)
+#endif
+
+#endif // SOLVE_STATS_H
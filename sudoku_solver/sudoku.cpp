@@ -0,0 +1,368 @@
+#include "sudoku.h"
+#include "bitboard.h"
+#include "propagate.h"
+#include "dlx.h"
+#include "iterative.h"
+#include "solve_stats.h"
+#include <cstring>
+using namespace std;
+
+bool isSafe(const vector<vector<int>>& grid, int N, int row, int col, int num) {
+    //Check in Row
+    for (int x = 0; x < N; x++)
+        if (grid[row][x] == num)
+            return false;
+
+    //Check in Coloumn
+    for (int x = 0; x < N; x++)
+        if (grid[x][col] == num)
+            return false;
+
+    //Box check, with the standard box shape for N
+    BoardGeometry geometry = BoardGeometry::standard(N);
+    if (geometry.hasBoxes()) {
+        int startRow = row - row % geometry.boxRows;
+        int startCol = col - col % geometry.boxCols;
+        for (int i = 0; i < geometry.boxRows; i++)
+            for (int j = 0; j < geometry.boxCols; j++)
+                if (grid[i + startRow][j + startCol] == num)
+                    return false;
+    }
+
+    return true;
+}
+
+bool isSafe(const Grid& grid, int row, int col, int num) {
+    int N = grid.N;
+    for (int k = 0; k < N; k++)
+        if (grid.cells[grid.rowCell(row, k)] == num || grid.cells[grid.colCell(col, k)] == num)
+            return false;
+
+    if (grid.geometry.hasBoxes()) {
+        int box = grid.boxOf(row, col);
+        for (int k = 0; k < N; k++)
+            if (grid.cells[grid.boxCell(box, k)] == num)
+                return false;
+    }
+    return true;
+}
+
+//Cell-by-cell search used when N is too large for the bitboard masks
+static bool solveSudokuScan(Grid& grid, int row, int col) {
+    int N = grid.N;
+    if (row == N - 1 && col == N)
+        return true;
+
+    if (col == N) {
+        row++;
+        col = 0;
+    }
+
+    if (grid.at(row, col) > 0)
+        return solveSudokuScan(grid, row, col + 1);
+
+    for (int num = 1; num <= N; num++) {
+        if (isSafe(grid, row, col, num)) {
+            grid.at(row, col) = num;
+            if (solveSudokuScan(grid, row, col + 1))
+                return true;
+        }
+        grid.at(row, col) = 0;
+    }
+    return false;
+}
+
+//Loads the board into a bitboard engine, runs search and writes the solution
+//back, timing both phases into stats
+template <class Engine, class Load>
+static bool runEngine(Engine& solver, Grid& grid, SolveControl* control, SolveStats* stats,
+                      SolveTrace* trace, Load load) {
+    if (trace != nullptr)
+        trace->beginPuzzle(grid.N);
+    SolveClock::time_point started;
+    if (stats != nullptr)
+        started = SolveClock::now();
+    load();
+    solver.control = control;
+    solver.stats = stats;
+    solver.trace = trace;
+    if (stats != nullptr) {
+        stats->loadSeconds += secondsSince(started);
+        started = SolveClock::now();
+    }
+    bool solved = solver.solve();
+    solver.stats = nullptr;
+    solver.trace = nullptr;
+    if (stats != nullptr) {
+        stats->solves++;
+        stats->searchSeconds += secondsSince(started);
+        stats->nodes += solver.nodes;
+    }
+    if (trace != nullptr)
+        trace->endPuzzle(solver.nodes, solved);
+    if (control != nullptr)
+        control->nodes.store(solver.nodes);
+    if (solved)
+        solver.store(grid);
+    return solved;
+}
+
+//Row-major bitboard search from (row, col)
+static bool solveBacktrack(Grid& grid, int row, int col, SolveControl* control,
+                           SolveStats* stats = nullptr, SolveTrace* trace = nullptr) {
+    if (grid.N > MAX_MASK_DIGITS)
+        return solveSudokuScan(grid, row, col);
+
+    //One engine per thread so its buffers are reused between puzzles
+    static thread_local IterativeSolver solver;
+    return runEngine(solver, grid, control, stats, trace, [&] { solver.load(grid, row * grid.N + col); });
+}
+
+//Runs a Grid solve on a vector board through a per-thread scratch grid
+template <class Solve>
+static bool solveRows(vector<vector<int>>& rows, int N, Solve solve) {
+    static thread_local Grid grid;
+    grid.fromRows(rows, N);
+    if (!solve(grid))
+        return false;
+    grid.toRows(rows);
+    return true;
+}
+
+bool solveSudoku(Grid& grid, int row, int col) {
+    return solveBacktrack(grid, row, col, nullptr);
+}
+
+bool solveSudoku(vector<vector<int>>& grid, int N, int row, int col) {
+    return solveRows(grid, N, [&](Grid& board) { return solveBacktrack(board, row, col, nullptr); });
+}
+
+bool parseSolveMode(const string& name, SolveMode& mode) {
+    if (name == "backtrack")
+        mode = SOLVE_BACKTRACK;
+    else if (name == "propagate")
+        mode = SOLVE_PROPAGATE;
+    else if (name == "dlx")
+        mode = SOLVE_DLX;
+    else
+        return false;
+    return true;
+}
+
+const char* solveModeName(SolveMode mode) {
+    switch (mode) {
+    case SOLVE_BACKTRACK: return "backtrack";
+    case SOLVE_PROPAGATE: return "propagate";
+    case SOLVE_DLX: return "dlx";
+    }
+    return "unknown";
+}
+
+bool solveSudokuWith(Grid& grid, SolveMode mode, SolveControl* control) {
+    return solveSudokuWith(grid, mode, control, nullptr, nullptr);
+}
+
+bool solveSudokuWith(Grid& grid, SolveMode mode, SolveControl* control, SolveStats* stats, SolveTrace* trace) {
+    if (mode == SOLVE_DLX) {
+        DlxMatrix& matrix = dlxMatrixFor(grid.geometry);
+        if (trace != nullptr)
+            trace->beginPuzzle(grid.N);
+        matrix.control = control;
+        matrix.stats = stats;
+        matrix.trace = trace;
+        bool solved = matrix.solve(grid);
+        matrix.stats = nullptr;
+        matrix.trace = nullptr;
+        if (stats != nullptr) {
+            stats->solves++;
+            stats->nodes += matrix.nodesVisited;
+        }
+        if (trace != nullptr)
+            trace->endPuzzle(matrix.nodesVisited, solved);
+        if (control != nullptr)
+            control->nodes.store(matrix.nodesVisited);
+        return solved;
+    }
+    if (mode == SOLVE_BACKTRACK || grid.N > MAX_MASK_DIGITS)
+        return solveBacktrack(grid, 0, 0, control, stats, trace);
+
+    static thread_local PropagationSolver solver;
+    bool solved = runEngine(solver, grid, control, stats, trace, [&] {
+        solver.load(grid);
+        solver.solutionLimit = 1;
+    });
+    if (stats != nullptr)
+        stats->guesses += solver.guesses;
+    return solved;
+}
+
+bool solveSudokuWith(vector<vector<int>>& grid, int N, SolveMode mode, SolveControl* control) {
+    return solveRows(grid, N, [&](Grid& board) { return solveSudokuWith(board, mode, control); });
+}
+
+//Row-major counting for boards too large for the masks
+static void countScan(Grid& grid, int cell, uint64_t limit, uint64_t& count, GridCells& first) {
+    int N = grid.N;
+    while (cell < N * N && grid.cells[cell] != 0)
+        cell++;
+    if (cell == N * N) {
+        if (count++ == 0)
+            first = grid.cells;
+        return;
+    }
+    for (int num = 1; num <= N && count < limit; num++) {
+        if (isSafe(grid, cell / N, cell % N, num)) {
+            grid.cells[cell] = num;
+            countScan(grid, cell + 1, limit, count, first);
+        }
+    }
+    grid.cells[cell] = 0;
+}
+
+uint64_t countSolutions(Grid& grid, uint64_t limit, SolveControl* control, SolveStats* stats) {
+    if (limit == 0)
+        return 0;
+    if (grid.N > MAX_MASK_DIGITS) {
+        uint64_t count = 0;
+        GridCells first;
+        countScan(grid, 0, limit, count, first);
+        if (count > 0)
+            grid.cells = first;
+        return count;
+    }
+
+    static thread_local PropagationSolver solver;
+    SolveClock::time_point started;
+    if (stats != nullptr)
+        started = SolveClock::now();
+    solver.load(grid);
+    solver.control = control;
+    solver.stats = stats;
+    solver.solutionLimit = limit;
+    if (stats != nullptr) {
+        stats->solves++;
+        stats->loadSeconds += secondsSince(started);
+        started = SolveClock::now();
+    }
+    bool reachedLimit = solver.solve();
+    solver.stats = nullptr;
+    if (control != nullptr)
+        control->nodes.store(solver.nodes);
+    if (stats != nullptr) {
+        stats->searchSeconds += secondsSince(started);
+        stats->nodes += solver.nodes;
+        stats->guesses += solver.guesses;
+    }
+    if (solver.cancelled || solver.solutions == 0)
+        return 0;
+    //With limit 1 the board is still on the solver, otherwise it was copied
+    if (limit == 1 && reachedLimit)
+        solver.store(grid);
+    else
+        memcpy(grid.data(), solver.firstSolution.data(), solver.firstSolution.size());
+    return solver.solutions;
+}
+
+//Pairwise duplicate scan of every unit; cell(row, col) reads the board.
+//Slow but takes any N and any cell values.
+template <class Cell>
+static bool validByScan(const Cell& cell, const BoardGeometry& geometry) {
+    int N = geometry.N;
+    auto inBox = [&](int box, int k) {
+        int at = geometry.boxCell(box, k);
+        return cell(at / N, at % N);
+    };
+    for (int unit = 0; unit < N; unit++) {
+        for (int i = 1; i < N; i++) {
+            int inRow = cell(unit, i);
+            int inCol = cell(i, unit);
+            int boxed = geometry.hasBoxes() ? inBox(unit, i) : 0;
+            for (int j = 0; j < i; j++) {
+                if (inRow != 0 && cell(unit, j) == inRow)
+                    return false; // Duplicate in row
+                if (inCol != 0 && cell(j, unit) == inCol)
+                    return false; // Duplicate in column
+                if (boxed != 0 && inBox(unit, j) == boxed)
+                    return false; // Duplicate in box
+            }
+        }
+    }
+    return true;
+}
+
+//One pass over the board with a digit mask per row, column and box, so
+//no unit is scanned twice and nothing is allocated. Values a mask cannot
+//hold (negative or above MAX_MASK_DIGITS) go through validByScan(). shape
+//gives the box of a cell: the geometry itself, or FixedBoxes.
+template <class Cell, class Shape>
+static bool validByMasks(const Cell& cell, const BoardGeometry& geometry, const Shape& shape) {
+    int N = geometry.N;
+    if (N > MAX_MASK_DIGITS)
+        return validByScan(cell, geometry);
+
+    DigitMask rowUsed[MAX_MASK_DIGITS], colUsed[MAX_MASK_DIGITS], boxUsed[MAX_MASK_DIGITS];
+    for (int unit = 0; unit < N; unit++)
+        rowUsed[unit] = colUsed[unit] = boxUsed[unit] = 0;
+    for (int row = 0; row < N; row++) {
+        for (int col = 0; col < N; col++) {
+            int num = cell(row, col);
+            if (num == 0)
+                continue;
+            if (num < 0 || num > MAX_MASK_DIGITS)
+                return validByScan(cell, geometry);
+            DigitMask bit = DigitMask(1) << (num - 1);
+            if ((rowUsed[row] | colUsed[col]) & bit)
+                return false;
+            rowUsed[row] |= bit;
+            colUsed[col] |= bit;
+            if (shape.hasBoxes()) {
+                int box = shape.boxOf(row, col);
+                if (boxUsed[box] & bit)
+                    return false;
+                boxUsed[box] |= bit;
+            }
+        }
+    }
+    return true;
+}
+
+//Box arithmetic of FixedGrid, known at compile time
+template <int SIZE>
+struct FixedBoxes {
+    bool hasBoxes() const { return true; }
+    int boxOf(int row, int col) const { return FixedGrid<SIZE>::boxOf(row, col); }
+};
+
+//Same with the board size and box arithmetic fixed at compile time
+template <int SIZE>
+static bool isValidFixed(const uint8_t* cells) {
+    const int BLOCK = FixedGrid<SIZE>::BLOCK;
+    return validByMasks([cells](int row, int col) { return (int)cells[FixedGrid<SIZE>::rowCell(row, col)]; },
+                        BoardGeometry(SIZE, BLOCK, BLOCK), FixedBoxes<SIZE>());
+}
+
+bool isValidSudoku(const vector<vector<int>>& grid, int N) {
+    BoardGeometry geometry = BoardGeometry::standard(N);
+    return validByMasks([&grid](int row, int col) { return grid[row][col]; }, geometry, geometry);
+}
+
+bool isValidCells(const uint8_t* cells, int N) {
+    return isValidCells(cells, BoardGeometry::standard(N));
+}
+
+bool isValidCells(const uint8_t* cells, const BoardGeometry& geometry) {
+    int N = geometry.N;
+    if (geometry.hasBoxes() && geometry.boxRows == geometry.boxCols) {
+        switch (N) {
+        case 4: return isValidFixed<4>(cells);
+        case 9: return isValidFixed<9>(cells);
+        case 16: return isValidFixed<16>(cells);
+        case 25: return isValidFixed<25>(cells);
+        }
+    }
+    return validByMasks([cells, N](int row, int col) { return (int)cells[row * N + col]; }, geometry, geometry);
+}
+
+bool isValidSudoku(const Grid& grid) {
+    return isValidCells(grid.data(), grid.geometry);
+}
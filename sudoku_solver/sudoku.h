@@ -0,0 +1,59 @@
+#ifndef SUDOKU_H
+#define SUDOKU_H
+
+#include <string>
+#include <vector>
+#include "grid.h"
+#include "solve_control.h"
+
+struct SolveStats;
+struct SolveTrace;
+
+//Search engines selectable at runtime
+enum SolveMode {
+    SOLVE_BACKTRACK,    //Row-major backtracking, same order as solveSudoku()
+    SOLVE_PROPAGATE,    //Naked/hidden singles plus fewest-candidates branching
+    SOLVE_DLX           //Exact cover with Dancing Links
+};
+
+//"backtrack", "propagate" or "dlx"; returns false for an unknown name
+bool parseSolveMode(const std::string& name, SolveMode& mode);
+const char* solveModeName(SolveMode mode);
+
+bool isSafe(const std::vector<std::vector<int>>& grid, int N, int row, int col, int num);
+bool isSafe(const Grid& grid, int row, int col, int num);
+
+//Fills every empty cell from (row, col) onwards in row-major order.
+//Returns false and leaves the grid untouched when there is no solution.
+//Runs on IterativeSolver (iterative.h), so deep boards do not grow the call stack.
+bool solveSudoku(std::vector<std::vector<int>>& grid, int N, int row, int col);
+bool solveSudoku(Grid& grid, int row, int col);
+
+//Fills every empty cell of the board with the chosen engine.
+//Returns false and leaves the grid untouched when there is no solution or
+//the control was cancelled. The control also receives progress.
+bool solveSudokuWith(std::vector<std::vector<int>>& grid, int N, SolveMode mode,
+                     SolveControl* control = nullptr);
+bool solveSudokuWith(Grid& grid, SolveMode mode, SolveControl* control = nullptr);
+//Same, adding what the solve did to stats (see solve_stats.h) and recording
+//its guesses in trace as puzzle trace->puzzle. Either may be null.
+bool solveSudokuWith(Grid& grid, SolveMode mode, SolveControl* control, SolveStats* stats,
+                     SolveTrace* trace = nullptr);
+
+//Counts the solutions of a board that passed isValidSudoku(), stopping once
+//limit are found (limit 2 answers "is it unique?"). When there is at least
+//one, the first solution is written to the grid. Returns 0 and leaves the
+//grid untouched when cancelled.
+uint64_t countSolutions(Grid& grid, uint64_t limit, SolveControl* control = nullptr,
+                        SolveStats* stats = nullptr);
+
+//Rows, columns and, when the shape has them, boxes hold no digit twice.
+//Boards given by N alone get BoardGeometry::standard(N).
+bool isValidSudoku(const std::vector<std::vector<int>>& grid, int N);
+//Same checks on a flat board, with its own box shape
+bool isValidSudoku(const Grid& grid);
+//Same on N*N row-major cells
+bool isValidCells(const uint8_t* cells, int N);
+bool isValidCells(const uint8_t* cells, const BoardGeometry& geometry);
+
+#endif // SUDOKU_H
@@ -0,0 +1,436 @@
+//Headless batch solver: no SDL, reads one puzzle per line from a file or stdin
+//and streams one solution per line to stdout. With --generate it writes new
+//puzzles instead; with --serve it answers requests on a Unix socket, and
+//--connect sends the puzzles to such a server.
+#include "batch.h"
+#include "corpus.h"
+#include "generator.h"
+#include "puzzle_io.h"
+#include "solve_cache.h"
+#include "solve_service.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+using namespace std;
+
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [--engine backtrack|propagate|dlx] [--threads N] [--unordered] [--parallel-search] [--count LIMIT] [--stats] [--trace FILE] [--records FILE] [--cache ENTRIES] [--cache-file FILE] [--box RxC] [--quiet] [file|-]" << endl;
+    cerr << "       " << program << " --convert FILE [--pack byte|nibble] [--box RxC] [file|-]" << endl;
+    cerr << "       " << program << " --serve SOCKET [--engine ...] [--threads N] [--cache ENTRIES] [--cache-file FILE] [--box RxC] [--deadline US] [--batch N] [--max-pending N] [--quiet]" << endl;
+    cerr << "       " << program << " --connect SOCKET [--deadline US] [--window N] [--quiet] [file|-]" << endl;
+    cerr << "       " << program << " --generate COUNT [--size N | --box RxC] [--difficulty any|easy|medium|hard] [--seed S] [--min-clues K] [--quiet]" << endl;
+}
+
+//Writes count puzzles, one per line
+static int generatePuzzles(uint64_t count, const BoardGeometry& geometry, Difficulty difficulty, uint64_t seed,
+                           int minClues, bool quiet) {
+    int N = geometry.N;
+    if (N < 1 || N > MAX_PUZZLE_DIGITS) {
+        cerr << "Unsupported size: " << N << endl;
+        return 2;
+    }
+    PuzzleGenerator generator(seed);
+    generator.minClues = minClues;
+    Grid puzzle;
+    OutputBuffer writer(stdout);
+    string line;
+    uint64_t made = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (uint64_t k = 0; k < count; k++) {
+        if (!generator.generate(geometry, difficulty, puzzle))
+            continue;
+        line.clear();
+        formatPuzzle(puzzle, line);
+        line += '\n';
+        writer.append(line);
+        made++;
+    }
+    writer.flush();
+
+    if (!quiet) {
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cerr << made << " " << difficultyName(difficulty) << " puzzles of size " << N << " in " << seconds << " s";
+        if (seconds > 0)
+            cerr << " (" << (uint64_t)(made / seconds) << " per second)";
+        cerr << endl;
+    }
+    return made == count ? 0 : 1;
+}
+
+//Board size of the first puzzle of a text stream, which is read ahead and
+//put back; 0 when it has no puzzle, -1 when the stream cannot seek
+static int firstPuzzleSize(FILE* in) {
+    long at = ftell(in);
+    if (at < 0)
+        return -1;
+    int N = 0;
+    {
+        LineReader reader(in, 1 << 16);
+        Grid grid;
+        const char* line;
+        size_t length;
+        while (N == 0 && reader.next(line, length))
+            if (puzzleField(line, length) && parsePuzzle(line, length, grid))
+                N = grid.N;
+    }
+    return fseek(in, at, SEEK_SET) == 0 ? N : -1;
+}
+
+//Packs the puzzle lines of inputPath into a binary corpus
+static int convertCorpus(const char* inputPath, const char* outputPath, bool bytePacked, const BoardGeometry& boxes,
+                         bool quiet) {
+    FILE* in = stdin;
+    if (strcmp(inputPath, "-") != 0) {
+        in = fopen(inputPath, "rb");
+        if (in == nullptr) {
+            cerr << "Cannot open " << inputPath << endl;
+            return 1;
+        }
+    }
+    FILE* out = fopen(outputPath, "wb");
+    if (out == nullptr) {
+        cerr << "Cannot write " << outputPath << endl;
+        if (in != stdin)
+            fclose(in);
+        return 1;
+    }
+
+    uint64_t converted, skipped;
+    bool ok = convertPuzzles(in, out, bytePacked, boxes, converted, skipped);
+    if (in != stdin)
+        fclose(in);
+    if (fclose(out) != 0 || !ok) {
+        cerr << "Cannot write " << outputPath << endl;
+        return 1;
+    }
+    if (!quiet) {
+        cerr << converted << " puzzles converted";
+        if (skipped > 0)
+            cerr << ", " << skipped << " lines skipped";
+        cerr << endl;
+    }
+    return 0;
+}
+
+static SolveServer* runningServer = nullptr;
+
+static void stopServer(int) {
+    if (runningServer != nullptr)
+        runningServer->stop();
+}
+
+//Serves until SIGINT or SIGTERM
+static int serveRequests(const char* path, const ServiceOptions& service, bool quiet) {
+    SolveServer server(service);
+    string error;
+    if (!server.listen(path, &error)) {
+        cerr << "Cannot listen on " << path << ": " << error << endl;
+        return 1;
+    }
+    runningServer = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+#ifdef SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    if (!quiet)
+        cerr << "Listening on " << path << endl;
+    server.run();
+    runningServer = nullptr;
+
+    if (!quiet) {
+        ServiceStats stats = server.stats();
+        cerr << stats.requests << " requests on " << stats.connections << " connections in " << stats.batches
+             << " batches: " << stats.solved << " solved, " << stats.invalid << " invalid, " << stats.unsolvable
+             << " unsolvable, " << stats.timedOut << " timed out" << endl;
+    }
+    return 0;
+}
+
+//Sends the puzzles of inputPath to a server and prints the replies in order
+static int solveThroughServer(const char* path, const char* inputPath, const RemoteOptions& remote, bool quiet) {
+    FILE* in = stdin;
+    if (strcmp(inputPath, "-") != 0) {
+        in = fopen(inputPath, "rb");
+        if (in == nullptr) {
+            cerr << "Cannot open " << inputPath << endl;
+            return 1;
+        }
+    }
+    RemoteStats stats;
+    string error;
+    bool ok = solveRemote(path, in, stdout, remote, stats, &error);
+    if (in != stdin)
+        fclose(in);
+    if (!ok) {
+        cerr << "Cannot solve through " << path << ": " << error << endl;
+        return 1;
+    }
+
+    if (!quiet) {
+        cerr << stats.puzzles << " puzzles: " << stats.solved << " solved, " << stats.invalid << " invalid, "
+             << stats.unsolvable << " unsolvable, " << stats.timedOut << " timed out in " << stats.seconds << " s";
+        if (stats.seconds > 0)
+            cerr << " (" << (uint64_t)(stats.puzzles / stats.seconds) << " per second)";
+        cerr << endl;
+        vector<double> latencies = stats.latencyMicros;
+        if (!latencies.empty()) {
+            sort(latencies.begin(), latencies.end());
+            size_t last = latencies.size() - 1;
+            cerr << "latency: p50 " << latencies[last / 2] << " us, p99 " << latencies[last * 99 / 100]
+                 << " us, max " << latencies[last] << " us" << endl;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    BatchOptions options;
+    const char* inputPath = "-";
+    bool quiet = false;
+    uint64_t generateCount = 0;
+    int generateSize = 9;
+    BoardGeometry boxes;
+    Difficulty difficulty = DIFFICULTY_ANY;
+    uint64_t seed = 1;
+    int minClues = 0;
+    const char* tracePath = nullptr;
+    const char* convertPath = nullptr;
+    const char* recordsPath = nullptr;
+    bool bytePacked = false;
+    bool sizeGiven = false;
+    size_t cacheEntries = 0;
+    const char* cachePath = nullptr;
+    const char* servePath = nullptr;
+    const char* connectPath = nullptr;
+    ServiceOptions service;
+    RemoteOptions remote;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--engine" && i + 1 < argc) {
+            if (!parseSolveMode(argv[++i], options.mode)) {
+                cerr << "Unknown engine: " << argv[i] << endl;
+                return 2;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (arg == "--unordered") {
+            options.unordered = true;
+        } else if (arg == "--parallel-search") {
+            options.parallelSearch = true;
+        } else if (arg == "--count" && i + 1 < argc) {
+            options.countLimit = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--generate" && i + 1 < argc) {
+            generateCount = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--size" && i + 1 < argc) {
+            generateSize = atoi(argv[++i]);
+            sizeGiven = true;
+        } else if (arg == "--box" && i + 1 < argc) {
+            if (!BoardGeometry::parse(argv[++i], boxes)) {
+                cerr << "Bad box shape: " << argv[i] << endl;
+                return 2;
+            }
+        } else if (arg == "--difficulty" && i + 1 < argc) {
+            if (!parseDifficulty(argv[++i], difficulty)) {
+                cerr << "Unknown difficulty: " << argv[i] << endl;
+                return 2;
+            }
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--min-clues" && i + 1 < argc) {
+            minClues = atoi(argv[++i]);
+        } else if (arg == "--stats") {
+            options.collectStats = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--convert" && i + 1 < argc) {
+            convertPath = argv[++i];
+        } else if (arg == "--records" && i + 1 < argc) {
+            recordsPath = argv[++i];
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheEntries = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--cache-file" && i + 1 < argc) {
+            cachePath = argv[++i];
+        } else if (arg == "--serve" && i + 1 < argc) {
+            servePath = argv[++i];
+        } else if (arg == "--connect" && i + 1 < argc) {
+            connectPath = argv[++i];
+        } else if (arg == "--deadline" && i + 1 < argc) {
+            service.deadlineMicros = remote.deadlineMicros = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--window" && i + 1 < argc) {
+            remote.window = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            service.maxBatch = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--max-pending" && i + 1 < argc) {
+            service.maxPending = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--pack" && i + 1 < argc) {
+            string pack = argv[++i];
+            if (pack != "byte" && pack != "nibble") {
+                cerr << "Unknown packing: " << pack << endl;
+                return 2;
+            }
+            bytePacked = pack == "byte";
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "-" || arg[0] != '-') {
+            inputPath = argv[i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    //--box fixes the board size; --size only has to agree with it
+    if (boxes.N != 0) {
+        if (sizeGiven && generateSize != boxes.N) {
+            cerr << "Box shape " << boxes.boxRows << "x" << boxes.boxCols << " does not fit size " << generateSize << endl;
+            return 2;
+        }
+        generateSize = boxes.N;
+        options.boxes = boxes;
+    }
+
+    if (generateCount > 0)
+        return generatePuzzles(generateCount, boxes.N != 0 ? boxes : BoardGeometry::standard(generateSize),
+                               difficulty, seed, minClues, quiet);
+
+    if (convertPath != nullptr)
+        return convertCorpus(inputPath, convertPath, bytePacked, boxes, quiet);
+
+    if (connectPath != nullptr)
+        return solveThroughServer(connectPath, inputPath, remote, quiet);
+
+    //--cache-file alone keeps the default capacity
+    unique_ptr<SolveCache> cache;
+    if (cacheEntries > 0 || cachePath != nullptr) {
+        cache.reset(cacheEntries > 0 ? new SolveCache(cacheEntries) : new SolveCache());
+        string error;
+        if (cachePath != nullptr && !cache->load(cachePath, &error)) {
+            cerr << "Cannot read " << cachePath << ": " << error << endl;
+            return 1;
+        }
+        options.cache = cache.get();
+    }
+
+    if (servePath != nullptr) {
+        service.mode = options.mode;
+        service.threads = options.threads;
+        service.cache = options.cache;
+        service.boxes = options.boxes;
+        int status = serveRequests(servePath, service, quiet);
+        if (status == 0 && cachePath != nullptr && !cache->save(cachePath)) {
+            cerr << "Cannot write " << cachePath << endl;
+            return 1;
+        }
+        return status;
+    }
+
+    //Binary corpora are mapped instead of read through a stream
+    CorpusReader corpus;
+    bool binaryInput = strcmp(inputPath, "-") != 0 && CorpusReader::isCorpus(inputPath);
+    if (binaryInput) {
+        string error;
+        if (!corpus.open(inputPath, &error)) {
+            cerr << "Cannot read " << inputPath << ": " << error << endl;
+            return 1;
+        }
+    }
+    FILE* in = stdin;
+    if (!binaryInput && strcmp(inputPath, "-") != 0) {
+        in = fopen(inputPath, "rb");
+        if (in == nullptr) {
+            cerr << "Cannot open " << inputPath << endl;
+            return 1;
+        }
+    }
+
+    //Records take the size given by --size or --box, else that of the first puzzle,
+    //and the box shape of --box, else that of a binary input of that size
+    CorpusWriter records;
+    FILE* recordsFile = nullptr;
+    if (recordsPath != nullptr) {
+        int N = generateSize;
+        if (!sizeGiven && boxes.N == 0) {
+            int first = binaryInput ? corpus.size() : firstPuzzleSize(in);
+            if (first < 0) {
+                cerr << "--records needs --size or --box when the input cannot be read ahead" << endl;
+                return 2;
+            }
+            if (first > 0)
+                N = first;
+        }
+        BoardGeometry shape = BoardGeometry::standard(N);
+        if (boxes.N != 0)
+            shape = boxes;
+        else if (binaryInput && corpus.size() == N)
+            shape = corpus.format().geometry;
+        recordsFile = strcmp(recordsPath, "-") == 0 ? stdout : fopen(recordsPath, "wb");
+        if (recordsFile == nullptr
+            || !records.begin(recordsFile, CorpusFormat::forBoard(shape, bytePacked, CORPUS_SOLUTIONS | CORPUS_STATS))) {
+            cerr << "Cannot write " << recordsPath << endl;
+            return 1;
+        }
+        options.recordOut = &records;
+    }
+
+    SolveTrace trace;
+    if (tracePath != nullptr) {
+        if (!SOLVE_INSTRUMENTED)
+            cerr << "Built without SUDOKU_INSTRUMENT, the trace will have no guesses" << endl;
+        options.trace = &trace;
+    }
+
+    BatchStats stats = binaryInput ? solveBatch(corpus, stdout, options) : solveBatch(in, stdout, options);
+    if (in != stdin)
+        fclose(in);
+    if (recordsFile != nullptr) {
+        bool written = records.finish();
+        if ((recordsFile != stdout && fclose(recordsFile) != 0) || !written) {
+            cerr << "Cannot write " << recordsPath << endl;
+            return 1;
+        }
+    }
+
+    if (cachePath != nullptr && !cache->save(cachePath)) {
+        cerr << "Cannot write " << cachePath << endl;
+        return 1;
+    }
+
+    if (tracePath != nullptr) {
+        FILE* out = fopen(tracePath, "w");
+        if (out == nullptr) {
+            cerr << "Cannot write " << tracePath << endl;
+            return 1;
+        }
+        trace.writeJson(out);
+        fclose(out);
+        if (trace.truncated)
+            cerr << "Trace truncated after " << trace.events.size() << " events" << endl;
+    }
+
+    if (!quiet) {
+        cerr << stats.puzzles << " puzzles: " << stats.solved << " solved, "
+             << stats.invalid << " invalid, " << stats.unsolvable << " unsolvable";
+        if (options.countLimit > 0)
+            cerr << ", " << stats.multiple << " with several solutions";
+        cerr << endl;
+        if (cache != nullptr) {
+            SolveCacheStats cached = cache->stats();
+            cerr << "cache: " << cached.hits << " hits, " << cached.misses << " misses, "
+                 << cached.evictions << " evictions, " << cache->size() << " entries" << endl;
+        }
+    }
+    if (options.collectStats)
+        stats.solve.print(stderr);
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <cstdio>
+#include <vector>
+#include "generator.h"
+
+//Shared by the test_* executables, each of which checks one module against a
+//plain reference or a round trip, on random boards from a fixed seed
+
+inline int& checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline void check(bool ok, const char* test, const char* what) {
+    if (!ok) {
+        //The first few are enough to tell what broke
+        if (checkFailures() < 20)
+            printf("%s: %s\n", test, what);
+        checkFailures()++;
+    }
+}
+
+//Random 9x9 puzzles with unique solutions, and their solutions
+inline void makePuzzles(int count, uint64_t seed, std::vector<Grid>& puzzles, std::vector<Grid>& solutions) {
+    PuzzleGenerator generator(seed);
+    Grid puzzle, solution;
+    while ((int)puzzles.size() < count) {
+        if (!generator.generate(9, DIFFICULTY_ANY, puzzle, &solution))
+            continue;
+        puzzles.push_back(puzzle);
+        solutions.push_back(solution);
+    }
+}
+
+//Exit status of the executable: 1 when any check failed
+inline int checksResult(const char* name) {
+    if (checkFailures() > 0) {
+        printf("%s: %d checks failed\n", name, checkFailures());
+        return 1;
+    }
+    printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+#endif // TEST_CHECK_H
@@ -0,0 +1,128 @@
+//Corpus records holding cells above N come out invalid whatever path
+//solveChunk() takes, CorpusReader refuses headers it does not know, and a
+//corpus keeps the box shape it was written with
+#include "batch.h"
+#include "corpus.h"
+#include "puzzle_io.h"
+#include "test_check.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdlib>
+#include <unistd.h>
+#endif
+using namespace std;
+
+//Name of a new, empty file in the temporary directory; corpora are opened by path
+static string tempPath() {
+#ifdef _WIN32
+    char directory[MAX_PATH], path[MAX_PATH];
+    if (GetTempPathA(MAX_PATH, directory) == 0 || GetTempFileNameA(directory, "sdk", 0, path) == 0)
+        return "test_corpus.sdkb";
+    return path;
+#else
+    const char* directory = getenv("TMPDIR");
+    string path = string(directory != nullptr && *directory != '\0' ? directory : "/tmp") + "/test_corpus_XXXXXX";
+    int descriptor = mkstemp(&path[0]);
+    if (descriptor < 0)
+        return "test_corpus.sdkb";
+    close(descriptor);
+    return path;
+#endif
+}
+
+//Writes a one-record corpus and returns the batch status line for it
+static string solveRecord(const char* path, const BoardGeometry& shape, bool bytePacked, const vector<uint8_t>& cells) {
+    FILE* file = fopen(path, "wb");
+    CorpusWriter writer;
+    if (file == nullptr || !writer.begin(file, CorpusFormat::forBoard(shape, bytePacked)) ||
+        !writer.append(cells.data()) || !writer.finish() || fclose(file) != 0)
+        return "cannot write";
+    CorpusReader reader;
+    if (!reader.open(path))
+        return "cannot read";
+    FILE* out = tmpfile();
+    if (out == nullptr)
+        return "cannot write";
+    solveBatch(reader, out, BatchOptions());
+    rewind(out);
+    char line[256] = "";
+    if (fgets(line, sizeof(line), out) == nullptr)
+        line[0] = '\0';
+    fclose(out);
+    remove(path);
+    return string(line, strcspn(line, "\n"));
+}
+
+static void testCorpusRange() {
+    const char* test = "corpus records";
+    string name = tempPath();
+    const char* path = name.c_str();
+    vector<uint8_t> cells(81, 0);
+    cells[3] = 15;
+    BoardGeometry nine = BoardGeometry::standard(9);
+    check(solveRecord(path, nine, false, cells) == "invalid", test, "nibble cell above 9 is not invalid");
+    check(solveRecord(path, nine, true, cells) == "invalid", test, "byte cell above 9 is not invalid");
+    cells.assign(144, 0);
+    cells[5] = 200;
+    check(solveRecord(path, BoardGeometry::standard(12), true, cells) == "invalid", test,
+          "12x12 cell above 12 is not invalid");
+
+    //Empty corpora whose header alone is wrong
+    CorpusFormat badHeaders[] = { CorpusFormat(9, 8), CorpusFormat(MAX_PUZZLE_DIGITS + 1, 0),
+                                  CorpusFormat(BoardGeometry(12, 5, 3), 0) };
+    const char* problems[] = { "accepts unknown flags", "accepts boards above MAX_PUZZLE_DIGITS",
+                               "accepts a box shape that does not fit" };
+    for (int k = 0; k < 3; k++) {
+        uint8_t header[CORPUS_HEADER_SIZE];
+        badHeaders[k].writeHeader(header, 0);
+        FILE* file = fopen(path, "wb");
+        check(file != nullptr && fwrite(header, 1, sizeof(header), file) == sizeof(header) && fclose(file) == 0,
+              test, "cannot write");
+        CorpusReader reader;
+        check(!reader.open(path), test, problems[k]);
+    }
+    remove(path);
+}
+
+//A 12x12 puzzle with 4x3 boxes has another solution, or none, under the
+//standard 3x4 ones, so solving it without being told the shape shows
+//whether the shape came back from the header
+static void testCorpusShape() {
+    const char* test = "corpus box shape";
+    string name = tempPath();
+    const char* path = name.c_str();
+    BoardGeometry shape(12, 4, 3);
+    PuzzleGenerator generator(5);
+    Grid puzzle, solution;
+    check(generator.generate(shape, DIFFICULTY_ANY, puzzle, &solution), test, "cannot generate");
+    string expected;
+    formatPuzzle(solution, expected);
+    for (int packing = 0; packing < 2; packing++) {
+        string line = solveRecord(path, shape, packing == 1, vector<uint8_t>(puzzle.cells.begin(), puzzle.cells.end()));
+        check(line.compare(0, expected.size(), expected) == 0, test, "solved without its box shape");
+    }
+
+    //Version 1 headers have no shape and mean the standard one
+    uint8_t header[CORPUS_HEADER_SIZE];
+    CorpusFormat(shape, 0).writeHeader(header, 0);
+    header[4] = 1;
+    FILE* file = fopen(path, "wb");
+    check(file != nullptr && fwrite(header, 1, sizeof(header), file) == sizeof(header) && fclose(file) == 0,
+          test, "cannot write");
+    CorpusReader reader;
+    check(reader.open(path) && reader.format().geometry == BoardGeometry::standard(12), test,
+          "version 1 header does not read as the standard shape");
+    reader.close();
+    remove(path);
+}
+
+int main() {
+    testCorpusRange();
+    testCorpusShape();
+    return checksResult("test_corpus");
+}
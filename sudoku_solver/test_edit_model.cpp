@@ -0,0 +1,88 @@
+//EditModel against isValidSudoku() and scans of the units, after every one
+//of a few thousand random edits on boards from 4x4 to 64x64
+#include "edit_model.h"
+#include "generator.h"
+#include "sudoku.h"
+#include "test_check.h"
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+//Whether a unit of a board holds a digit twice, by brute force
+static bool hasRepeat(const Grid& grid) {
+    int N = grid.N;
+    for (int unit = 0; unit < N; unit++)
+        for (int a = 0; a < N; a++)
+            for (int b = a + 1; b < N; b++) {
+                int cells[3][2] = { { grid.rowCell(unit, a), grid.rowCell(unit, b) },
+                                    { grid.colCell(unit, a), grid.colCell(unit, b) },
+                                    { grid.geometry.hasBoxes() ? grid.boxCell(unit, a) : 0,
+                                      grid.geometry.hasBoxes() ? grid.boxCell(unit, b) : 0 } };
+                for (int kind = 0; kind < (grid.geometry.hasBoxes() ? 3 : 2); kind++) {
+                    int x = grid.cells[cells[kind][0]], y = grid.cells[cells[kind][1]];
+                    if (x != 0 && x == y)
+                        return true;
+                }
+            }
+    return false;
+}
+
+static void testEditModel() {
+    const char* test = "EditModel";
+    SplitMix64 rng(41);
+    BoardGeometry shapes[] = { BoardGeometry(4, 2, 2), BoardGeometry(9, 3, 3), BoardGeometry(6, 2, 3),
+                               BoardGeometry(12, 3, 4), BoardGeometry(7, 0, 0), BoardGeometry(64, 8, 8) };
+    for (const BoardGeometry& shape : shapes) {
+        int N = shape.N;
+        EditModel model(shape);
+        Grid reference(shape);
+        vector<char> before(N * N);
+        vector<int> changed;
+        for (int edit = 0; edit < 3000; edit++) {
+            for (int cell = 0; cell < N * N; cell++)
+                before[cell] = model.conflicts(cell / N, cell % N);
+            int row = rng.next() % N, col = rng.next() % N;
+            int value = rng.next() % 3 == 0 ? 0 : 1 + rng.next() % N;
+            changed.clear();
+            model.set(row, col, value, &changed);
+            reference.at(row, col) = value;
+            check(model.isValid() == isValidSudoku(reference), test, "isValid() differs from isValidSudoku()");
+
+            //One random cell against a scan of its units: it conflicts when
+            //its digit is elsewhere in them, and a digit is a candidate when not
+            int r = rng.next() % N, c = rng.next() % N;
+            Grid probe = reference;
+            int digit = probe.at(r, c);
+            bool clash = false;
+            DigitMask allowed = 0;
+            for (int d = 1; d <= N; d++) {
+                probe.at(r, c) = 0;
+                bool free = true;
+                for (int k = 0; k < N; k++) {
+                    free = free && probe.at(r, k) != d && probe.at(k, c) != d;
+                    if (shape.hasBoxes())
+                        free = free && probe.cells[probe.boxCell(probe.boxOf(r, c), k)] != d;
+                }
+                if (free)
+                    allowed |= DigitMask(1) << (d - 1);
+                if (d == digit)
+                    clash = !free;
+            }
+            check(model.conflicts(r, c) == clash, test, "conflicts() differs from a scan");
+            check(model.candidates(r, c) == allowed, test, "candidates() differs from a scan");
+
+            for (int cell = 0; cell < N * N; cell++)
+                if (before[cell] != model.conflicts(cell / N, cell % N))
+                    check(find(changed.begin(), changed.end(), cell) != changed.end(), test,
+                          "a cell whose conflict changed was not reported");
+        }
+        EditModel loaded;
+        loaded.load(reference);
+        check(loaded.isValid() == !hasRepeat(reference), test, "load() counts differently");
+    }
+}
+
+int main() {
+    testEditModel();
+    return checksResult("test_edit_model");
+}
@@ -0,0 +1,63 @@
+//IterativeSolver checkpoints: a search suspended every few nodes and resumed
+//through the file form in a fresh solver ends on the same solution, and
+//states run() never writes are refused
+#include "iterative.h"
+#include "test_check.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+using namespace std;
+
+static void testCheckpoints() {
+    const char* test = "checkpoints";
+    vector<Grid> puzzles, solutions;
+    makePuzzles(5, 31, puzzles, solutions);
+    for (size_t k = 0; k < puzzles.size(); k++) {
+        //Suspend every few nodes, go through the file form and carry on in a
+        //fresh solver; the search has to end on the same solution
+        IterativeSolver solver;
+        solver.load(puzzles[k]);
+        while (solver.run(7) == IterativeSolver::SEARCH_RUNNING) {
+            SearchCheckpoint saved, loaded;
+            solver.saveCheckpoint(saved);
+            FILE* file = tmpfile();
+            check(file != nullptr && saved.write(file), test, "write() failed");
+            if (file == nullptr)
+                return;
+            rewind(file);
+            check(loaded.read(file), test, "read() failed");
+            fclose(file);
+            IterativeSolver resumed;
+            check(resumed.restoreCheckpoint(loaded), test, "a saved checkpoint is rejected");
+            solver = resumed;
+        }
+        check(solver.state == IterativeSolver::SEARCH_SOLVED, test, "resumed search did not solve");
+        Grid board = puzzles[k];
+        solver.store(board);
+        check(board.cells == solutions[k].cells, test, "resumed search found another board");
+
+        //States run() never leaves behind
+        solver.load(puzzles[k]);
+        solver.run(20);
+        SearchCheckpoint good, bad;
+        solver.saveCheckpoint(good);
+        if (good.digits.empty())
+            continue;
+        IterativeSolver other;
+        bad = good;
+        bad.digits.back() = 0;
+        bad.entering = false;
+        check(!other.restoreCheckpoint(bad), test, "accepts a frame without a digit");
+        bad = good;
+        bad.untried.back() |= DigitMask(1) << 63;
+        check(!other.restoreCheckpoint(bad), test, "accepts untried digits above N");
+        bad = good;
+        *find(bad.puzzle.rbegin(), bad.puzzle.rend(), 0) = 12;     //Last empty cell, below the frames
+        check(!other.restoreCheckpoint(bad), test, "accepts a given above N");
+    }
+}
+
+int main() {
+    testCheckpoints();
+    return checksResult("test_iterative");
+}
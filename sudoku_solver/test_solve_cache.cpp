@@ -0,0 +1,84 @@
+//Canonical cache keys: boards related by a Sudoku symmetry share a key, and
+//the board transform maps canonical cells, and solutions, back exactly
+#include "solve_cache.h"
+#include "sudoku.h"
+#include "test_check.h"
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//Random order of the 9 lines of a direction: the three bands (or stacks)
+//shuffled, and the lines inside each
+static void shuffleLines(int* lines, SplitMix64& rng) {
+    int bands[3] = { 0, 1, 2 };
+    for (int b = 2; b > 0; b--)
+        swap(bands[b], bands[rng.next() % (b + 1)]);
+    for (int b = 0; b < 3; b++) {
+        int inside[3] = { 0, 1, 2 };
+        for (int r = 2; r > 0; r--)
+            swap(inside[r], inside[rng.next() % (r + 1)]);
+        for (int r = 0; r < 3; r++)
+            lines[b * 3 + r] = bands[b] * 3 + inside[r];
+    }
+}
+
+//Applies a random Sudoku symmetry to a 9x9 board: digit relabeling, band,
+//stack, row and column swaps, and maybe a transposition
+static Grid shuffleSudoku(const Grid& board, SplitMix64& rng) {
+    int digits[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    for (int d = 9; d > 1; d--)
+        swap(digits[d], digits[1 + rng.next() % d]);
+    int rows[9], cols[9];
+    shuffleLines(rows, rng);
+    shuffleLines(cols, rng);
+    bool transpose = rng.next() % 2 != 0;
+    Grid shuffled(9);
+    for (int r = 0; r < 9; r++)
+        for (int c = 0; c < 9; c++) {
+            int value = digits[board.at(rows[r], cols[c])];
+            if (transpose)
+                shuffled.at(c, r) = value;
+            else
+                shuffled.at(r, c) = value;
+        }
+    return shuffled;
+}
+
+static void testCanonicalKeys() {
+    const char* test = "canonicalizeBoard";
+    vector<Grid> puzzles, solutions;
+    makePuzzles(20, 21, puzzles, solutions);
+    SplitMix64 rng(22);
+    string key, shuffledKey;
+    BoardTransform transform, shuffledTransform;
+    vector<uint8_t> canonical(81), back(81);
+    for (size_t k = 0; k < puzzles.size(); k++) {
+        canonicalizeBoard(puzzles[k], key, transform);
+        for (int round = 0; round < 5; round++) {
+            Grid shuffled = shuffleSudoku(puzzles[k], rng);
+            canonicalizeBoard(shuffled, shuffledKey, shuffledTransform);
+            check(key == shuffledKey, test, "equivalent boards get different keys");
+
+            //The canonical board goes back to the board it came from, and so
+            //does a solution of it
+            shuffledTransform.apply(shuffled.data(), canonical.data());
+            shuffledTransform.invert(canonical.data(), back.data());
+            check(memcmp(back.data(), shuffled.data(), 81) == 0, test, "invert() does not undo apply()");
+
+            Grid solution = shuffled;
+            check(solveSudokuWith(solution, SOLVE_PROPAGATE), test, "shuffled puzzle does not solve");
+            shuffledTransform.apply(solution.data(), canonical.data());
+            shuffledTransform.invert(canonical.data(), back.data());
+            check(memcmp(back.data(), solution.data(), 81) == 0, test, "solution does not map back");
+        }
+        canonicalizeBoard(puzzles[(k + 1) % puzzles.size()], shuffledKey, shuffledTransform);
+        check(key != shuffledKey, test, "different puzzles share a key");
+    }
+}
+
+int main() {
+    testCanonicalKeys();
+    return checksResult("test_solve_cache");
+}
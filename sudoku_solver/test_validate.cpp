@@ -0,0 +1,42 @@
+//validateBoards9() against isValidCells() on solved, partial, broken and
+//out-of-range boards, in counts that leave partial SIMD groups
+#include "sudoku.h"
+#include "test_check.h"
+#include "validate.h"
+#include <vector>
+using namespace std;
+
+static void testValidateBoards9() {
+    const char* test = "validateBoards9";
+    vector<Grid> puzzles, solutions;
+    makePuzzles(20, 11, puzzles, solutions);
+    SplitMix64 rng(12);
+
+    //Solved, partial, broken and out-of-range boards, in group sizes that
+    //leave partial SIMD groups
+    vector<uint8_t> boards;
+    for (int k = 0; k < 1000; k++) {
+        Grid board = (k % 2 ? puzzles : solutions)[k % 20];
+        int change = k % 5;
+        if (change == 1)
+            board.cells[rng.next() % 81] = 1 + rng.next() % 9;
+        else if (change == 2)
+            board.cells[rng.next() % 81] = 0;
+        else if (change == 3)
+            board.cells[rng.next() % 81] = 10 + rng.next() % 246;
+        boards.insert(boards.end(), board.cells.begin(), board.cells.end());
+    }
+    for (size_t count : { (size_t)0, (size_t)1, (size_t)15, (size_t)17, (size_t)33, (size_t)1000 }) {
+        vector<uint8_t> valid(count, 2);
+        validateBoards9(boards.data(), count, valid.data());
+        for (size_t k = 0; k < count; k++)
+            check(valid[k] == (isValidCells(boards.data() + k * 81, 9) ? 1 : 0), test,
+                  "differs from isValidCells()");
+    }
+}
+
+int main() {
+    testValidateBoards9();
+    printf("validate kernel: %s\n", validateKernelName());
+    return checksResult("test_validate");
+}
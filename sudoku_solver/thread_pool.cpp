@@ -0,0 +1,104 @@
+#include "thread_pool.h"
+using namespace std;
+
+static thread_local WorkStealingPool* currentPool = nullptr;
+static thread_local int currentIndex = -1;
+
+WorkStealingPool::WorkStealingPool(int threads) {
+    if (threads <= 0)
+        threads = defaultThreads();
+    for (int i = 0; i < threads; i++)
+        queues.emplace_back(new Queue());
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(&WorkStealingPool::run, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> lock(sleepLock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+int WorkStealingPool::currentWorker() {
+    return currentIndex;
+}
+
+int WorkStealingPool::defaultThreads() {
+    unsigned cores = thread::hardware_concurrency();
+    return cores > 0 ? (int)cores : 1;
+}
+
+void WorkStealingPool::submit(Task task) {
+    pending.fetch_add(1);
+    int target = (currentPool == this) ? currentIndex : (int)(nextQueue.fetch_add(1) % queues.size());
+    {
+        lock_guard<mutex> lock(queues[target]->lock);
+        queues[target]->tasks.push_back(move(task));
+    }
+    queued.fetch_add(1);
+
+    //Taking the lock orders this against a worker about to sleep
+    {
+        lock_guard<mutex> lock(sleepLock);
+    }
+    wakeUp.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    unique_lock<mutex> lock(sleepLock);
+    allDone.wait(lock, [this] { return pending.load() == 0; });
+}
+
+bool WorkStealingPool::popOwn(int worker, Task& task) {
+    Queue& queue = *queues[worker];
+    lock_guard<mutex> lock(queue.lock);
+    if (queue.tasks.empty())
+        return false;
+    task = move(queue.tasks.back());
+    queue.tasks.pop_back();
+    queued.fetch_sub(1);
+    return true;
+}
+
+bool WorkStealingPool::steal(int worker, Task& task) {
+    int count = (int)queues.size();
+    for (int i = 1; i < count; i++) {
+        Queue& queue = *queues[(worker + i) % count];
+        lock_guard<mutex> lock(queue.lock);
+        if (queue.tasks.empty())
+            continue;
+        task = move(queue.tasks.front());
+        queue.tasks.pop_front();
+        queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::run(int worker) {
+    currentPool = this;
+    currentIndex = worker;
+
+    while (true) {
+        Task task;
+        if (popOwn(worker, task) || steal(worker, task)) {
+            task(worker);
+            if (pending.fetch_sub(1) == 1) {
+                lock_guard<mutex> lock(sleepLock);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        idle.fetch_add(1);
+        unique_lock<mutex> lock(sleepLock);
+        wakeUp.wait(lock, [this] { return stopping || queued.load() > 0; });
+        idle.fetch_sub(1);
+        if (stopping && queued.load() == 0)
+            return;
+    }
+}
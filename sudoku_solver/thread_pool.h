@@ -0,0 +1,65 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed set of worker threads, each with its own task deque. A worker pops the
+//newest task from its own deque and, when that is empty, steals the oldest
+//task from another worker. Tasks receive the index of the worker running them
+//so they can reuse per-worker buffers.
+class WorkStealingPool {
+public:
+    typedef std::function<void(int worker)> Task;
+
+    explicit WorkStealingPool(int threads);
+    ~WorkStealingPool();
+
+    //From a worker the task goes on that worker's deque, otherwise the
+    //deques are filled round-robin
+    void submit(Task task);
+
+    //Blocks until every submitted task has finished
+    void wait();
+
+    int size() const { return (int)workers.size(); }
+
+    //Workers currently looking for work, used to decide when to split tasks
+    int idleWorkers() const { return idle.load(std::memory_order_relaxed); }
+
+    //Index of the calling worker in its pool, or -1 outside any pool
+    static int currentWorker();
+
+    //Threads to use when the caller asks for 0
+    static int defaultThreads();
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleepLock;
+    std::condition_variable wakeUp;
+    std::condition_variable allDone;
+    std::atomic<size_t> queued{0};      //Tasks sitting in deques
+    std::atomic<size_t> pending{0};     //Tasks submitted but not finished
+    std::atomic<int> idle{0};
+    std::atomic<unsigned> nextQueue{0};
+    bool stopping = false;
+
+    bool popOwn(int worker, Task& task);
+    bool steal(int worker, Task& task);
+    void run(int worker);
+};
+
+#endif // THREAD_POOL_H
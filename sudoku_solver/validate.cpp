@@ -0,0 +1,179 @@
+#include "validate.h"
+#include "grid.h"
+#include "sudoku.h"
+#include <cstdlib>
+#include <cstring>
+using namespace std;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SUDOKU_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+typedef FixedGrid<9> Layout9;
+
+static void validateScalar(const uint8_t* boards, size_t count, uint8_t* valid) {
+    for (size_t k = 0; k < count; k++)
+        valid[k] = isValidCells(boards + k * Layout9::CELLS, 9) ? 1 : 0;
+}
+
+#ifdef SUDOKU_X86_SIMD
+
+//Cell-major copy of up to lanes boards: stage[cell * lanes + board].
+//Missing boards are left empty, which is always valid.
+static void stageBoards(const uint8_t* boards, size_t count, int lanes, uint8_t* stage) {
+    for (int cell = 0; cell < Layout9::CELLS; cell++) {
+        uint8_t* row = stage + cell * lanes;
+        for (size_t k = 0; k < count; k++)
+            row[k] = boards[k * Layout9::CELLS + cell];
+        for (int k = (int)count; k < lanes; k++)
+            row[k] = 0;
+    }
+}
+
+//Lane results: bit k of dupBits set means board k has a duplicate, bit k of
+//inRangeBits clear means it holds a value over 9 and needs the exact check
+static void finishGroup(const uint8_t* boards, size_t count, uint32_t dupBits, uint32_t inRangeBits,
+                        uint8_t* valid) {
+    for (size_t k = 0; k < count; k++) {
+        if (!(inRangeBits & (1u << k)))
+            valid[k] = isValidCells(boards + k * Layout9::CELLS, 9) ? 1 : 0;
+        else
+            valid[k] = (dupBits & (1u << k)) ? 0 : 1;
+    }
+}
+
+//Digit d is split into two bit planes per byte lane: digits 1..8 map to one bit
+//of the low plane through a pshufb lookup, digit 9 to the high plane. A unit has
+//a duplicate when a digit's bit is already in the plane seen so far.
+__attribute__((target("ssse3")))
+static void validateSsse3(const uint8_t* boards, size_t count, uint8_t* valid) {
+    const int LANES = 16;
+    alignas(16) uint8_t stage[Layout9::CELLS * LANES];
+    __m128i lo[Layout9::CELLS], hi[Layout9::CELLS];
+    const __m128i lowTable = _mm_setr_epi8(0, 1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i nine = _mm_set1_epi8(9);
+
+    for (size_t base = 0; base < count; base += LANES) {
+        size_t group = count - base < (size_t)LANES ? count - base : LANES;
+        const uint8_t* first = boards + base * Layout9::CELLS;
+        stageBoards(first, group, LANES, stage);
+
+        __m128i inRange = _mm_set1_epi8(-1);
+        for (int cell = 0; cell < Layout9::CELLS; cell++) {
+            __m128i v = _mm_load_si128((const __m128i*)(stage + cell * LANES));
+            inRange = _mm_and_si128(inRange, _mm_cmpeq_epi8(_mm_max_epu8(v, nine), nine));
+            lo[cell] = _mm_shuffle_epi8(lowTable, v);
+            hi[cell] = _mm_cmpeq_epi8(v, nine);
+        }
+
+        __m128i dup = _mm_setzero_si128();
+        for (int unit = 0; unit < 9; unit++) {
+            __m128i rowLo = _mm_setzero_si128(), rowHi = _mm_setzero_si128();
+            __m128i colLo = _mm_setzero_si128(), colHi = _mm_setzero_si128();
+            __m128i boxLo = _mm_setzero_si128(), boxHi = _mm_setzero_si128();
+            for (int k = 0; k < 9; k++) {
+                int r = Layout9::rowCell(unit, k), c = Layout9::colCell(unit, k), b = Layout9::boxCell(unit, k);
+                dup = _mm_or_si128(dup, _mm_or_si128(_mm_and_si128(rowLo, lo[r]), _mm_and_si128(rowHi, hi[r])));
+                dup = _mm_or_si128(dup, _mm_or_si128(_mm_and_si128(colLo, lo[c]), _mm_and_si128(colHi, hi[c])));
+                dup = _mm_or_si128(dup, _mm_or_si128(_mm_and_si128(boxLo, lo[b]), _mm_and_si128(boxHi, hi[b])));
+                rowLo = _mm_or_si128(rowLo, lo[r]);
+                rowHi = _mm_or_si128(rowHi, hi[r]);
+                colLo = _mm_or_si128(colLo, lo[c]);
+                colHi = _mm_or_si128(colHi, hi[c]);
+                boxLo = _mm_or_si128(boxLo, lo[b]);
+                boxHi = _mm_or_si128(boxHi, hi[b]);
+            }
+        }
+
+        uint32_t dupBits = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(dup, _mm_setzero_si128())) & 0xFFFF;
+        uint32_t inRangeBits = (uint32_t)_mm_movemask_epi8(inRange);
+        finishGroup(first, group, dupBits, inRangeBits, valid + base);
+    }
+}
+
+//Same as validateSsse3() with 32 lanes
+__attribute__((target("avx2")))
+static void validateAvx2(const uint8_t* boards, size_t count, uint8_t* valid) {
+    const int LANES = 32;
+    alignas(32) uint8_t stage[Layout9::CELLS * LANES];
+    __m256i lo[Layout9::CELLS], hi[Layout9::CELLS];
+    //vpshufb looks up within each 128-bit half, so the table is repeated
+    const __m256i lowTable = _mm256_setr_epi8(0, 1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i nine = _mm256_set1_epi8(9);
+
+    for (size_t base = 0; base < count; base += LANES) {
+        size_t group = count - base < (size_t)LANES ? count - base : LANES;
+        const uint8_t* first = boards + base * Layout9::CELLS;
+        stageBoards(first, group, LANES, stage);
+
+        __m256i inRange = _mm256_set1_epi8(-1);
+        for (int cell = 0; cell < Layout9::CELLS; cell++) {
+            __m256i v = _mm256_load_si256((const __m256i*)(stage + cell * LANES));
+            inRange = _mm256_and_si256(inRange, _mm256_cmpeq_epi8(_mm256_max_epu8(v, nine), nine));
+            lo[cell] = _mm256_shuffle_epi8(lowTable, v);
+            hi[cell] = _mm256_cmpeq_epi8(v, nine);
+        }
+
+        __m256i dup = _mm256_setzero_si256();
+        for (int unit = 0; unit < 9; unit++) {
+            __m256i rowLo = _mm256_setzero_si256(), rowHi = _mm256_setzero_si256();
+            __m256i colLo = _mm256_setzero_si256(), colHi = _mm256_setzero_si256();
+            __m256i boxLo = _mm256_setzero_si256(), boxHi = _mm256_setzero_si256();
+            for (int k = 0; k < 9; k++) {
+                int r = Layout9::rowCell(unit, k), c = Layout9::colCell(unit, k), b = Layout9::boxCell(unit, k);
+                dup = _mm256_or_si256(dup, _mm256_or_si256(_mm256_and_si256(rowLo, lo[r]), _mm256_and_si256(rowHi, hi[r])));
+                dup = _mm256_or_si256(dup, _mm256_or_si256(_mm256_and_si256(colLo, lo[c]), _mm256_and_si256(colHi, hi[c])));
+                dup = _mm256_or_si256(dup, _mm256_or_si256(_mm256_and_si256(boxLo, lo[b]), _mm256_and_si256(boxHi, hi[b])));
+                rowLo = _mm256_or_si256(rowLo, lo[r]);
+                rowHi = _mm256_or_si256(rowHi, hi[r]);
+                colLo = _mm256_or_si256(colLo, lo[c]);
+                colHi = _mm256_or_si256(colHi, hi[c]);
+                boxLo = _mm256_or_si256(boxLo, lo[b]);
+                boxHi = _mm256_or_si256(boxHi, hi[b]);
+            }
+        }
+
+        uint32_t dupBits = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(dup, _mm256_setzero_si256()));
+        uint32_t inRangeBits = (uint32_t)_mm256_movemask_epi8(inRange);
+        finishGroup(first, group, dupBits, inRangeBits, valid + base);
+    }
+}
+
+#endif // SUDOKU_X86_SIMD
+
+typedef void (*ValidateKernel)(const uint8_t*, size_t, uint8_t*);
+
+struct KernelChoice {
+    ValidateKernel kernel;
+    const char* name;
+};
+
+//SUDOKU_VALIDATE_KERNEL=ssse3|scalar picks a narrower kernel than the CPU
+//allows, so every kernel can be checked on one machine
+static KernelChoice pickKernel() {
+    const char* wanted = getenv("SUDOKU_VALIDATE_KERNEL");
+    bool any = wanted == nullptr;
+#ifdef SUDOKU_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && (any || strcmp(wanted, "avx2") == 0))
+        return KernelChoice{ validateAvx2, "avx2" };
+    if (__builtin_cpu_supports("ssse3") && (any || strcmp(wanted, "avx2") == 0 || strcmp(wanted, "ssse3") == 0))
+        return KernelChoice{ validateSsse3, "ssse3" };
+#endif
+    return KernelChoice{ validateScalar, "scalar" };
+}
+
+static const KernelChoice& kernelChoice() {
+    static const KernelChoice choice = pickKernel();
+    return choice;
+}
+
+void validateBoards9(const uint8_t* boards, size_t count, uint8_t* valid) {
+    kernelChoice().kernel(boards, count, valid);
+}
+
+const char* validateKernelName() {
+    return kernelChoice().name;
+}
@@ -0,0 +1,17 @@
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+#include <cstddef>
+#include <cstdint>
+
+//Checks count 9x9 boards stored back to back as 81 row-major bytes each and
+//sets valid[k] to 1 or 0, matching isValidCells(board k, 9). Groups of boards
+//are transposed so each SIMD byte lane holds one board: AVX2 checks 32 boards
+//per pass, SSSE3 16, and other CPUs fall back to the scalar check.
+void validateBoards9(const uint8_t* boards, size_t count, uint8_t* valid);
+
+//"avx2", "ssse3" or "scalar", whichever validateBoards9() picked for this CPU
+//(or SUDOKU_VALIDATE_KERNEL asked for)
+const char* validateKernelName();
+
+#endif // VALIDATE_H